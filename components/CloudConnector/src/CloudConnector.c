@@ -8,47 +8,165 @@
  * For commercial licensing, contact: info.cyber@hensoldt.net
  */
 
+#include "system_config.h"
+
 #include "lib_debug/Debug.h"
 #include "TimeServer.h"
 
+#include <inttypes.h>
+#include <stdio.h>
 #include <string.h>
 #include <camkes.h>
 
 #include "glue_tls_mqtt.h"
+#include "client_sched.h"
+#include "config_params.h"
 #include "helper_func.h"
+#include "msg_ring.h"
+#include "sensor_record.h"
 
 #include "MQTT_client.h"
-#include "MQTTServer.h"
 
-#include "lib_utils/managedBuffer.h"
+#include "aggregator.h"
+#include "rules.h"
+#include "sample.h"
+#include "ts_batch.h"
+
+#include "OS_Dataport.h"
 
 /* Defines -------------------------------------------------------------------*/
-// the following defines are the parameter names that need to match the settings
-// in the configuration xml file. These will be passed to the configServer
-// component to retrieve the settings for the specified parameter
-#define DOMAIN_CLOUDCONNECTOR   "Domain-CloudConnector"
-#define CLOUD_DEVICE_ID_NAME    "IoT-Device"
-#define CLOUD_DOMAIN_NAME       "IoT-Hub"
-#define SERVER_ADDRESS_NAME     "CloudServiceIP"
-#define CLOUD_SAS_NAME          "SharedAccessSignature"
-#define SERVER_PORT_NAME        "ServerPort"
-#define SERVER_CA_CERT_NAME     "ServerCaCert"
-
-
-#define PAHO_TIMEOUT_MS_LISTEN   (1000 * 60 * 5)
-#define PAHO_TIMEOUT_MS_COMMAND  (1000 * 60 * 5)
+
+// Sending a packet must complete within the command timeout. The deadline for
+// a response of the broker adapts to the measured round trip times and stays
+// within the RTO bounds, so a lost PUBACK is detected within seconds.
+#define PAHO_TIMEOUT_MS_COMMAND      (1000 * 60)
+#define PAHO_TIMEOUT_MS_RTO_INITIAL  (1000 * 3)
+#define PAHO_TIMEOUT_MS_RTO_MIN      (1000 * 1)
+#define PAHO_TIMEOUT_MS_RTO_MAX      (1000 * 60)
 #define PAHO_SEND_BUFF_SIZE      1024
 #define PAHO_RECV_BUFF_SIZE      1024
 
+// When the connection to the broker is lost, it is re-established with an
+// exponential backoff between these bounds. Messages stay in the ring meanwhile.
+#define WAN_RETRY_MS_MIN         (1000 * 1)
+#define WAN_RETRY_MS_MAX         (1000 * 60)
+
+// Until the first session with the broker is up, the frames are moved from the
+// rings into the early queue, so the Sensors can keep enqueuing. The frames of
+// the rings fit into this buffer, together with the number of their client.
+// While waiting for a retry, the rings are emptied with this period.
+#define EARLY_FRAME_SIZE         2048
+#define EARLY_POLL_MS            500
+
+#define AGGREGATION_PAYLOAD_SIZE 160
+#define TOPIC_BUFF_SIZE          128
+#define VALUE_TEXT_SIZE          32
+
+// period of the throughput statistics of the published samples
+#define STATS_PERIOD_MS          (1000 * 60)
+
 // sizes chosen to at least fit the expected sizes of the parameters
-static char cloudDeviceName[128];
-static char cloudUsername[128];
-static char cloudSAS[192];
-static char serverIP[32];
-static char serverCert[4096];
+#define CLOUD_DEVICE_NAME_SIZE   128
+#define CLOUD_USERNAME_SIZE      128
+#define CLOUD_SAS_SIZE           192
+#define SERVER_IP_SIZE           32
+#define SERVER_CERT_SIZE         4096
+#define AGGREGATION_CFG_SIZE     512
+#define ENCODING_CFG_SIZE        512
+#define RULES_CFG_SIZE           512
+
+// The parameter ids, names and sizes in "config_params.h" are generated from
+// the configuration xml file. The values must fit into the buffers, the
+// strings with their terminating zero.
+#if (CONFIG_PARAM_CLOUDCONNECTOR_IOT_DEVICE_MAX_SIZE >= CLOUD_DEVICE_NAME_SIZE)
+#error "IoT-Device does not fit into cloudDeviceName"
+#endif
+#if (CONFIG_PARAM_CLOUDCONNECTOR_IOT_HUB_MAX_SIZE >= CLOUD_USERNAME_SIZE)
+#error "IoT-Hub does not fit into cloudUsername"
+#endif
+#if (CONFIG_PARAM_CLOUDCONNECTOR_SHAREDACCESSSIGNATURE_MAX_SIZE \
+     >= CLOUD_SAS_SIZE)
+#error "SharedAccessSignature does not fit into cloudSAS"
+#endif
+#if (CONFIG_PARAM_CLOUDCONNECTOR_CLOUDSERVICEIP_MAX_SIZE >= SERVER_IP_SIZE)
+#error "CloudServiceIP does not fit into serverIP"
+#endif
+#if (CONFIG_PARAM_CLOUDCONNECTOR_SERVERPORT_TYPE != CONFIG_PARAM_TYPE_INT32)
+#error "ServerPort is not an int32"
+#endif
+#if (CONFIG_PARAM_CLOUDCONNECTOR_SERVERCACERT_MAX_SIZE >= SERVER_CERT_SIZE)
+#error "ServerCaCert does not fit into serverCert"
+#endif
+#if (CONFIG_PARAM_CLOUDCONNECTOR_AGGREGATION_MAX_SIZE >= AGGREGATION_CFG_SIZE)
+#error "Aggregation does not fit into aggregationCfg"
+#endif
+#if (CONFIG_PARAM_CLOUDCONNECTOR_ENCODING_MAX_SIZE >= ENCODING_CFG_SIZE)
+#error "Encoding does not fit into encodingCfg"
+#endif
+#if (CONFIG_PARAM_CLOUDCONNECTOR_RULES_MAX_SIZE >= RULES_CFG_SIZE)
+#error "Rules does not fit into rulesCfg"
+#endif
+
+static char cloudDeviceName[CLOUD_DEVICE_NAME_SIZE];
+static char cloudUsername[CLOUD_USERNAME_SIZE];
+static char cloudSAS[CLOUD_SAS_SIZE];
+static char serverIP[SERVER_IP_SIZE];
+static uint32_t serverPort;
+static char serverCert[SERVER_CERT_SIZE];
+static char aggregationCfg[AGGREGATION_CFG_SIZE];
+static char encodingCfg[ENCODING_CFG_SIZE];
+static char rulesCfg[RULES_CFG_SIZE];
+
+// parameters that are fetched with one batched call at startup
+static const char* const configParameterNames[] =
+{
+    CONFIG_PARAM_CLOUDCONNECTOR_CLOUDSERVICEIP_NAME,
+    CONFIG_PARAM_CLOUDCONNECTOR_SERVERPORT_NAME,
+    CONFIG_PARAM_CLOUDCONNECTOR_SERVERCACERT_NAME,
+    CONFIG_PARAM_CLOUDCONNECTOR_IOT_HUB_NAME,
+    CONFIG_PARAM_CLOUDCONNECTOR_SHAREDACCESSSIGNATURE_NAME,
+    CONFIG_PARAM_CLOUDCONNECTOR_IOT_DEVICE_NAME,
+    CONFIG_PARAM_CLOUDCONNECTOR_AGGREGATION_NAME,
+    CONFIG_PARAM_CLOUDCONNECTOR_ENCODING_NAME,
+    CONFIG_PARAM_CLOUDCONNECTOR_RULES_NAME,
+};
 
 /* Instance variables --------------------------------------------------------*/
 OS_ConfigServiceHandle_t hConfig;
+
+static const if_ConfigBatch_t configBatch =
+    IF_CONFIG_BATCH_ASSIGN(
+        configBatch_rpc,
+        configServer_port);
+
+static const if_OS_Timer_t timer =
+    IF_OS_TIMER_ASSIGN(
+        timeServer_rpc,
+        timeServer_notify);
+
+#if (CLOUDCONNECTOR_NUM_CLIENTS < 1) \
+    || (CLOUDCONNECTOR_NUM_CLIENTS > CLIENT_SCHED_MAX_CLIENTS)
+#error "CLOUDCONNECTOR_NUM_CLIENTS out of range"
+#endif
+
+// one dataport with a message ring per Sensor client
+static const OS_Dataport_t sensorPorts[] =
+{
+    OS_DATAPORT_ASSIGN(sensor_port_1),
+#if (CLOUDCONNECTOR_NUM_CLIENTS > 1)
+    OS_DATAPORT_ASSIGN(sensor_port_2),
+#endif
+#if (CLOUDCONNECTOR_NUM_CLIENTS > 2)
+    OS_DATAPORT_ASSIGN(sensor_port_3),
+#endif
+#if (CLOUDCONNECTOR_NUM_CLIENTS > 3)
+    OS_DATAPORT_ASSIGN(sensor_port_4),
+#endif
+};
+
+static const unsigned int clientWeights[CLOUDCONNECTOR_NUM_CLIENTS] =
+    CLOUDCONNECTOR_CLIENT_WEIGHTS;
+
 typedef struct
 {
     Network             net;
@@ -56,41 +174,104 @@ typedef struct
     unsigned char       readBuff[PAHO_RECV_BUFF_SIZE];
 } CC_FSM_PAHO_NetCtx_t;
 
+// A topic name is resolved into the rule, the aggregation window and the
+// encoded series once when it is announced, readings refer to it by id.
+typedef struct
+{
+    char                        name[TOPIC_BUFF_SIZE]; // empty if unused
+    uint32_t                    nextSeq;
+    rules_program_t*            rule;
+    aggregator_window_t*        window;
+    ts_batch_series_t*          series;
+} CC_FSM_topic_t;
+
 typedef struct
 {
     struct
     {
         MQTT_client_t           client;
         CC_FSM_PAHO_NetCtx_t   client_netCtx;
-
-        MQTTServer              server;
-        CC_FSM_PAHO_NetCtx_t   server_netCtx;
     } paho;
 
     struct
     {
         MQTT_message_t          msg;
-        char*                   szTopic;
-        char                    buffer[PAHO_RECV_BUFF_SIZE];
+        const char*             szTopic;
+        char                    instanceTopic[TOPIC_BUFF_SIZE + 12];
+        char                    valueText[VALUE_TEXT_SIZE];
+        sample_t                sample;
+        size_t                  numSamples;
+        bool                    hasValue;
+        bool                    isPending;
+        msg_ring_t*             ring;  // ring that holds the pending frame
     } tmpDataPublish;
 
     struct
     {
-        size_t                  connect;
-        size_t                  pingreq;
-        size_t                  publish;
+        MQTTPacket_connectData  options;
+        uint32_t                retry_ms;
+    } wan;
+
+    msg_ring_t                  sensorRings[CLOUDCONNECTOR_NUM_CLIENTS];
+    client_sched_t              sched;
+
+    // frames received before the first session, they are forwarded first
+    struct
+    {
+        msg_ring_t              ring;
+        bool                    isActive;
+        size_t                  numQueued;
+        uint8_t                 frame[EARLY_FRAME_SIZE];
+    } early;
+
+    // topics announced by the clients, indexed by client and topic id
+    CC_FSM_topic_t  topics[CLOUDCONNECTOR_NUM_CLIENTS][SENSOR_RECORD_MAX_TOPICS];
+
+    rules_t                     rules;
+
+    struct
+    {
+        aggregator_t            ctx;
+        char                    payload[AGGREGATION_PAYLOAD_SIZE];
+    } aggregation;
+
+    struct
+    {
+        ts_batch_t              ctx;
+        uint8_t                 payload[TS_BATCH_FRAME_SIZE];
+    } encoding;
+
+    struct
+    {
+        size_t                  topics;
+        size_t                  readings;
+        size_t                  lost;
         size_t                  filtered;
+        size_t                  aggregated;
+        size_t                  encoded;
     } cnt;
+
+    struct
+    {
+        uint64_t                start_ms;
+        size_t                  messages;
+        size_t                  samples;
+    } stats;
 }
 CC_FSM_t;
 
 static CC_FSM_t cc_fsm;
 
+// the early queue is used by the WAN thread only, it is not shared
+static uint8_t earlyQueueBuf[CLOUDCONNECTOR_EARLY_QUEUE_SIZE]
+__attribute__((aligned(MSG_RING_CACHE_LINE)));
+
 //==============================================================================
 // external resources
 //==============================================================================
 
 OS_Error_t init_config_handle(OS_ConfigServiceHandle_t* configHandle);
+void benchmark_CloudConnector_run(void);
 
 //==============================================================================
 // internal functions
@@ -119,41 +300,41 @@ OS_Error_t
 set_mqtt_options(MQTTPacket_connectData* options)
 {
 
-    OS_Error_t ret = helper_func_getConfigParameter(&hConfig,
-                                                    DOMAIN_CLOUDCONNECTOR,
-                                                    CLOUD_DOMAIN_NAME,
-                                                    cloudUsername,
-                                                    sizeof(cloudUsername));
+    OS_Error_t ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_IOT_HUB,
+              cloudUsername,
+              sizeof(cloudUsername));
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
-                        CLOUD_DOMAIN_NAME, ret);
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_IOT_HUB_NAME, ret);
         return ret;
     }
     Debug_LOG_DEBUG("Retrieved CloudDomain: %s", cloudUsername);
 
-    ret = helper_func_getConfigParameter(&hConfig,
-                                         DOMAIN_CLOUDCONNECTOR,
-                                         CLOUD_SAS_NAME,
-                                         cloudSAS,
-                                         sizeof(cloudSAS));
+    ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_SHAREDACCESSSIGNATURE,
+              cloudSAS,
+              sizeof(cloudSAS));
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
-                        CLOUD_SAS_NAME, ret);
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_SHAREDACCESSSIGNATURE_NAME, ret);
         return ret;
     }
     Debug_LOG_DEBUG("Retrieved CloudSAS: %s", cloudSAS);
 
-    ret = helper_func_getConfigParameter(&hConfig,
-                                         DOMAIN_CLOUDCONNECTOR,
-                                         CLOUD_DEVICE_ID_NAME,
-                                         cloudDeviceName,
-                                         sizeof(cloudDeviceName));
+    ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_IOT_DEVICE,
+              cloudDeviceName,
+              sizeof(cloudDeviceName));
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
-                        CLOUD_DEVICE_ID_NAME, ret);
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_IOT_DEVICE_NAME, ret);
         return ret;
     }
     Debug_LOG_DEBUG("Retrieved DeviceName: %s", cloudDeviceName);
@@ -192,178 +373,443 @@ static int do_mqtt_connect(MQTT_client_t* client,
 }
 
 //------------------------------------------------------------------------------
-static int do_process_publish(CC_FSM_t* self,
-                              void* inputBuf,
-                              size_t inputBufLen)
+// Establish the TCP connection, the TLS session and the MQTT session with the
+// broker. Everything is torn down again on failure, so this can be retried.
+static int do_wan_connect(CC_FSM_t* self)
 {
-    MQTT_message_t* msg = &(self->tmpDataPublish.msg);
+    Debug_LOG_INFO("Setting TLS to IP:%s Port:%u ...", serverIP, serverPort);
+    OS_Error_t ret = glue_tls_init(serverIP,
+                                   serverCert,
+                                   sizeof(serverCert),
+                                   serverPort);
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("glue_tls_init() failed with code %d", ret);
+        return -1;
+    }
 
-    MQTTString topicObj;
-    MQTTLenString* topic = &(topicObj.lenstring);
-
-    // deserialize the packet.
-    int ret = MQTTDeserialize_publish(&(msg->dup),
-                                      (int*) & (msg->qos),
-                                      &(msg->retained),
-                                      &(msg->id),
-                                      &topicObj,
-                                      (unsigned char**) & (msg->payload),
-                                      (int*) & (msg->payloadlen),
-                                      inputBuf,
-                                      inputBufLen);
-    if (ret != 1)
-    {
-        Debug_LOG_ERROR("Malformed PUBLISH received!");
+    Debug_LOG_INFO("Establishing TLS session... ");
+    ret = do_tls_handshake();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("do_tls_handshake() failed with code %d", ret);
+        glue_tls_close();
         return -1;
     }
+    Debug_LOG_INFO("TLS session established successfully");
 
-    // sanity check: topic and payload must be in input buffer. Actually, there
-    // should be no need to check this, as MQTTDeserialize_publish() should
-    // do such kind of checks already.
-    Debug_ASSERT( is_buffer_in_buffer( topic->data, topic->len,
-                                       inputBuf, inputBufLen) );
-    Debug_ASSERT( is_buffer_in_buffer( msg->payload, msg->payloadlen,
-                                       inputBuf, inputBufLen) );
-
-    Debug_LOG_DEBUG("Deserialized PUBLISH: dup=%d, qos=%d, retained=%d, packetid=%d, topicName (len=%d):'%.*s' , payload (len=%d):'%.*s' ",
-                    (int) msg->dup,
-                    (int) msg->qos,
-                    (int) msg->retained,
-                    (int) msg->id,
-                    topic->len,
-                    topic->len,
-                    (char*)topic->data,
-                    msg->payloadlen,
-                    msg->payloadlen,
-                    (char*)msg->payload);
+    Debug_LOG_INFO("Establishing MQTT connection... ");
+    int err = do_mqtt_connect(&self->paho.client, &self->wan.options);
+    if (err != 0)
+    {
+        Debug_LOG_ERROR("do_mqtt_connect() failed with code %d", err);
+        glue_tls_close();
+        return -1;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Account the published message and report the end-to-end throughput of the
+// samples periodically.
+static void do_update_stats(CC_FSM_t* self)
+{
+    uint64_t now_ms = glue_tls_mqtt_getTimeMs();
 
-    if (msg->qos != 1)
+    self->stats.messages++;
+    self->stats.samples += self->tmpDataPublish.numSamples;
+
+    uint64_t elapsed_ms = now_ms - self->stats.start_ms;
+    if (elapsed_ms < STATS_PERIOD_MS)
     {
-        Debug_LOG_WARNING("incoming PUBLISH has QoS=%d, will set to 1", msg->qos);
-        msg->qos = 1;
+        return;
     }
 
-    if (msg->dup != 0)
+    if (self->stats.start_ms > 0)
     {
-        Debug_LOG_ERROR("incoming PUBLISH has DUP=%d, will ignore it.", msg->dup);
-        return -1;
+        Debug_LOG_INFO("published %zu samples in %zu messages in %" PRIu64
+                       " ms, %" PRIu64 " samples/s",
+                       self->stats.samples, self->stats.messages, elapsed_ms,
+                       self->stats.samples * 1000ULL / elapsed_ms);
     }
 
-    managedBuffer_t mb;
-    managedBuffer_init( &mb,
-                        self->tmpDataPublish.buffer,
-                        sizeof(self->tmpDataPublish.buffer) );
+    self->stats.start_ms = now_ms;
+    self->stats.messages = 0;
+    self->stats.samples  = 0;
+}
 
-    // copy topic into tmp buffer and make it a NULL-terminated string. Note
-    // that the topic itself in the packet is not NULL-terminated, but the MQTT
-    // API function to create the packet wants a NULL-terminated string with
-    // the topic name as parameter. Thus we need to add a NULL char here.
-    size_t lenTopicStr = topic->len + 1;
-    if (managedBuffer_getFreeSpace(&mb) < lenTopicStr)
+//------------------------------------------------------------------------------
+// Publish the pending message on the WAN. If this fails, the connection is
+// closed and the message stays pending until it has been re-established.
+static int do_wan_publish(CC_FSM_t* self)
+{
+    int ret = MQTT_client_publish(&(self->paho.client),
+                                  self->tmpDataPublish.szTopic,
+                                  &(self->tmpDataPublish.msg),
+                                  NULL);
+    if (ret != MQTT_SUCCESS)
     {
-        Debug_LOG_ERROR("tmp buffer too small for topic");
+        Debug_LOG_ERROR("MQTTPublish() failed with code %d", ret);
+        MQTT_client_disconnect(&self->paho.client);
+        glue_tls_close();
         return -1;
     }
+    Debug_LOG_INFO("MQTT publish on WAN successful");
+
+    self->tmpDataPublish.isPending = false;
+    do_update_stats(self);
+    // the connection is usable again, so the next loss is retried at once
+    self->wan.retry_ms = 0;
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Prepare the message for a reading. A text value is not copied, it stays in
+// the frame until the message has been published. Returns 1 if the message was
+// filtered by a rule and shall not be forwarded.
+static int do_process_reading(CC_FSM_t* self,
+                              const CC_FSM_topic_t* topic,
+                              const sensor_record_t* record,
+                              const void* data)
+{
+    MQTT_message_t* msg = &(self->tmpDataPublish.msg);
+    sample_t* sample = &(self->tmpDataPublish.sample);
+
+    msg->qos      = 1;
+    msg->retained = 0;
+    msg->dup      = 0;
+
+    // the numeric value is needed by the rules, the aggregation and the
+    // encoding. Messages without value pass the rules.
+    int len;
+    switch (record->type)
+    {
+    case SENSOR_RECORD_TYPE_F64:
+        sample->value = record->value.f64;
+        len = snprintf(self->tmpDataPublish.valueText,
+                       sizeof(self->tmpDataPublish.valueText),
+                       "%.15g", record->value.f64);
+        break;
 
-    self->tmpDataPublish.szTopic = (char*)managedBuffer_getFreeSpacePtr(&mb);
-    managedBuffer_append(&mb, topic->data, topic->len);
-    managedBuffer_appendChar(&mb, '\0');
+    case SENSOR_RECORD_TYPE_I64:
+        sample->value = (double)record->value.i64;
+        len = snprintf(self->tmpDataPublish.valueText,
+                       sizeof(self->tmpDataPublish.valueText),
+                       "%" PRId64, record->value.i64);
+        break;
+
+    case SENSOR_RECORD_TYPE_BATCH:
+        // the packed samples are published as they are
+        msg->payload    = (void*)data;
+        msg->payloadlen = record->value.dataLen;
+        self->tmpDataPublish.hasValue = false;
+        len = -1;
+        break;
 
-    void* payloadBuffer = (char*)managedBuffer_getFreeSpacePtr(&mb);
+    default: // SENSOR_RECORD_TYPE_TEXT
+        msg->payload    = (void*)data;
+        msg->payloadlen = record->value.dataLen;
+        self->tmpDataPublish.hasValue =
+            (OS_SUCCESS == sample_parsePayload(msg->payload,
+                                               msg->payloadlen,
+                                               &sample->value));
+        len = -1;
+        break;
+    }
 
-    if (managedBuffer_getFreeSpace(&mb) < msg->payloadlen)
+    if (len >= 0)
     {
-        Debug_LOG_ERROR("tmp buffer too small for payload");
-        return -1;
+        msg->payload    = self->tmpDataPublish.valueText;
+        msg->payloadlen = len;
+        self->tmpDataPublish.hasValue = true;
     }
 
-    managedBuffer_append(&mb, msg->payload, msg->payloadlen);
+    sample->timestamp_ms = record->timestamp_ms;
+
+    Debug_LOG_DEBUG("reading #%u of '%s', payload (len=%zu):'%.*s'",
+                    record->seq,
+                    topic->name,
+                    msg->payloadlen,
+                    (int)msg->payloadlen,
+                    (char*)msg->payload);
 
-    // make payload point to the temp buffer content
-    msg->payload = payloadBuffer;
+    if ((NULL != topic->rule) && self->tmpDataPublish.hasValue
+        && !rules_evaluate(topic->rule, sample->timestamp_ms, sample->value))
+    {
+        self->cnt.filtered++;
+        return 1;
+    }
+
+    self->tmpDataPublish.szTopic = topic->name;
+    if (record->flags & SENSOR_RECORD_FLAG_INSTANCE)
+    {
+        snprintf(self->tmpDataPublish.instanceTopic,
+                 sizeof(self->tmpDataPublish.instanceTopic),
+                 "%s/%" PRIu32, topic->name, record->instance);
+        self->tmpDataPublish.szTopic = self->tmpDataPublish.instanceTopic;
+    }
 
     return 0;
 }
 
-//==============================================================================
-// MQTT packet handlers
-//==============================================================================
+//------------------------------------------------------------------------------
+static OS_Error_t
+init_aggregation(CC_FSM_t* self)
+{
+    // the aggregation is optional, without it every message is forwarded
+    OS_Error_t ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_AGGREGATION,
+              aggregationCfg,
+              sizeof(aggregationCfg) - 1);
+    if (ret == OS_ERROR_CONFIG_PARAMETER_NOT_FOUND)
+    {
+        Debug_LOG_INFO("No aggregation configured");
+        return OS_SUCCESS;
+    }
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_AGGREGATION_NAME, ret);
+        return ret;
+    }
+
+    return aggregator_init(&self->aggregation.ctx,
+                           aggregationCfg,
+                           sizeof(aggregationCfg));
+}
 
 //------------------------------------------------------------------------------
-static int handle_MQTT_CONNECT(CC_FSM_t* self)
+static OS_Error_t
+init_rules(CC_FSM_t* self)
 {
-    self->cnt.connect++;
-    Debug_LOG_DEBUG("received MQTT CONNECT #%u", self->cnt.connect);
-    MQTTServer_sendConnAck(&self->paho.server, 0, 0);
+    // the rules are optional, without them every message is forwarded
+    OS_Error_t ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_RULES,
+              rulesCfg,
+              sizeof(rulesCfg) - 1);
+    if (ret == OS_ERROR_CONFIG_PARAMETER_NOT_FOUND)
+    {
+        Debug_LOG_INFO("No rules configured");
+        return OS_SUCCESS;
+    }
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_RULES_NAME, ret);
+        return ret;
+    }
 
-    return 0;
+    return rules_init(&self->rules, rulesCfg, sizeof(rulesCfg));
 }
 
 //------------------------------------------------------------------------------
-static int handle_MQTT_PINGREQ(CC_FSM_t* self)
+// Account the message to the aggregation window of its topic. Returns true if
+// there is something to publish, which is the summary of a closed window or the
+// message itself if it has no numeric value. Returns false if the message was
+// absorbed by the window.
+static bool do_aggregate(CC_FSM_t* self,
+                         aggregator_window_t* window)
 {
-    // For the scope of this demo, we will ignore the MQTT Subscribe events
-    Debug_LOG_WARNING("received MQTT PINGREQ, ignored");
+    MQTT_message_t* msg = &(self->tmpDataPublish.msg);
+    const sample_t* sample = &(self->tmpDataPublish.sample);
 
-    return 0;
+    if (!self->tmpDataPublish.hasValue)
+    {
+        Debug_LOG_WARNING("no numeric value in payload, publish it unaggregated");
+        return true;
+    }
+
+    aggregator_summary_t summary;
+    if (!aggregator_addSample(window, sample->timestamp_ms, sample->value,
+                              &summary))
+    {
+        self->cnt.aggregated++;
+        return false;
+    }
+
+    int len = snprintf(self->aggregation.payload,
+                       sizeof(self->aggregation.payload),
+                       "{\"start\":%" PRIu64 ",\"end\":%" PRIu64
+                       ",\"count\":%zu,\"min\":%.2f,\"max\":%.2f,\"mean\":%.2f}",
+                       summary.start_ms,
+                       summary.end_ms,
+                       summary.count,
+                       summary.min,
+                       summary.max,
+                       summary.mean);
+    if ((len < 0) || (len >= sizeof(self->aggregation.payload)))
+    {
+        Debug_LOG_ERROR("summary does not fit into payload buffer");
+        return true;
+    }
+
+    Debug_LOG_DEBUG("window closed, %zu samples summarized", summary.count);
+
+    msg->payload    = self->aggregation.payload;
+    msg->payloadlen = len;
+
+    return true;
 }
 
 //------------------------------------------------------------------------------
-static int handle_MQTT_SUBSCRIBE(CC_FSM_t* self)
+static OS_Error_t
+init_encoding(CC_FSM_t* self)
 {
-    // For the scope of this demo, we will ignore the MQTT Subsribe events
-    Debug_LOG_WARNING("received MQTT SUBSCRIBE, ignored");
+    // the encoding is optional, without it payloads are forwarded as they are
+    OS_Error_t ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_ENCODING,
+              encodingCfg,
+              sizeof(encodingCfg) - 1);
+    if (ret == OS_ERROR_CONFIG_PARAMETER_NOT_FOUND)
+    {
+        Debug_LOG_INFO("No encoding configured");
+        return OS_SUCCESS;
+    }
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_ENCODING_NAME, ret);
+        return ret;
+    }
 
-    return 0;
+    return ts_batch_init(&self->encoding.ctx,
+                         encodingCfg,
+                         sizeof(encodingCfg));
 }
 
 //------------------------------------------------------------------------------
-static int handle_MQTT_unsupportedPacket(CC_FSM_t* self,
-                                         int packet_type)
+// Add the message value to the encoded frame of its topic. Returns true if
+// there is something to publish, which is a complete frame or the message
+// itself if it has no numeric value. Returns false if the message was absorbed
+// by the frame.
+static bool do_encode(CC_FSM_t* self,
+                      ts_batch_series_t* series)
 {
-    Debug_LOG_WARNING("received unsupported packet type %d, ignored", packet_type);
+    MQTT_message_t* msg = &(self->tmpDataPublish.msg);
+    const sample_t* sample = &(self->tmpDataPublish.sample);
+
+    if (!self->tmpDataPublish.hasValue)
+    {
+        Debug_LOG_WARNING("no numeric value in payload, publish it unencoded");
+        return true;
+    }
+
+    size_t frameLen;
+    if (!ts_batch_addSample(series, sample->timestamp_ms, sample->value,
+                            self->encoding.payload, &frameLen))
+    {
+        self->cnt.encoded++;
+        return false;
+    }
+
+    Debug_LOG_DEBUG("frame complete, %zu bytes", frameLen);
 
-    // we've received a unsupported packet, ignore this
+    msg->payload    = self->encoding.payload;
+    msg->payloadlen = frameLen;
+
+    return true;
+}
+
+//==============================================================================
+// record handlers
+//==============================================================================
+
+//------------------------------------------------------------------------------
+static int handle_RECORD_TOPIC(CC_FSM_t* self,
+                               size_t client,
+                               const sensor_record_t* record,
+                               const void* data)
+{
+    CC_FSM_topic_t* topic = &(self->topics[client][record->topicId]);
+
+    if ((0 == record->value.dataLen)
+        || (record->value.dataLen >= sizeof(topic->name)))
+    {
+        Debug_LOG_ERROR("topic name of %u bytes not supported",
+                        record->value.dataLen);
+        return -1;
+    }
+
+    // the topic is resolved here once, readings refer to it by id only
+    memcpy(topic->name, data, record->value.dataLen);
+    topic->name[record->value.dataLen] = '\0';
+    topic->nextSeq = record->seq;
+    topic->rule    = rules_find(&self->rules, topic->name, strlen(topic->name));
+    topic->window  = aggregator_find(&self->aggregation.ctx, topic->name);
+    topic->series  = ts_batch_find(&self->encoding.ctx, topic->name);
+
+    self->cnt.topics++;
+    Debug_LOG_INFO("client %zu announced topic #%u '%s'",
+                   client, record->topicId, topic->name);
 
     return 0;
 }
 
 //------------------------------------------------------------------------------
-static int handle_MQTT_PUBLISH(CC_FSM_t* self)
+static int handle_RECORD_READING(CC_FSM_t* self,
+                                 size_t client,
+                                 const sensor_record_t* record,
+                                 const void* data)
 {
-    // in case of error we wait for the next packet. This is ok, as there is
-    // no channel to the sender of the packets to report errors.
+    // in case of error we wait for the next record. This is ok, as there is
+    // no channel to the sender of the records to report errors.
 
-    self->cnt.publish++;
-    Debug_LOG_DEBUG("received MQTT PUBLISH #%u", self->cnt.publish);
+    CC_FSM_topic_t* topic = &(self->topics[client][record->topicId]);
+    if ('\0' == topic->name[0])
+    {
+        Debug_LOG_ERROR("client %zu sent reading for unknown topic #%u",
+                        client, record->topicId);
+        return 0;
+    }
 
-    // the buffer from the MQTT server connection holds the packet. Process it
-    // and populate a message that is send out on the WAN
-    CC_FSM_PAHO_NetCtx_t* netCtx_server = &(self->paho.server_netCtx);
+    self->cnt.readings++;
+
+    // the Sensor drops readings if the ring is full, a batch holds several
+    // readings with consecutive sequence numbers
+    size_t numSamples = sensor_record_getNumSamples(record);
+    uint32_t gap = record->seq - topic->nextSeq;
+    if (gap > 0)
+    {
+        Debug_LOG_WARNING("%u reading(s) of '%s' lost", gap, topic->name);
+        self->cnt.lost += gap;
+    }
+    topic->nextSeq = record->seq + numSamples;
+    self->tmpDataPublish.numSamples = numSamples;
 
-    int ret = do_process_publish(self,
-                                 netCtx_server->readBuff,
-                                 sizeof(netCtx_server->readBuff));
+    int ret = do_process_reading(self, topic, record, data);
     if (ret != 0)
     {
-        Debug_LOG_ERROR("do_process_publish() failed with code %d", ret);
-        // don't report the error to caller, just listen for the next package
+        Debug_LOG_DEBUG("message filtered by rule");
         return 0;
     }
 
-    //
-
-    ret = MQTT_client_publish(&(self->paho.client),
-                              self->tmpDataPublish.szTopic,
-                              &(self->tmpDataPublish.msg),
-                              NULL);
-    if (ret != MQTT_SUCCESS)
+    // a batch is published as one message, the rules, the aggregation and
+    // the encoding work on single readings. The windows and the series are
+    // per topic, so readings of several instances are not mixed into them. A
+    // topic is either aggregated or encoded, aggregation takes precedence.
+    if ((SENSOR_RECORD_TYPE_BATCH == record->type)
+        || (record->flags & SENSOR_RECORD_FLAG_INSTANCE))
     {
-        Debug_LOG_ERROR("MQTTPublish() failed with code %d", ret);
-        MQTT_client_disconnect(&self->paho.client);
-        return -1;
+        Debug_LOG_DEBUG("%zu sample(s) published as they are", numSamples);
+    }
+    else if ((NULL != topic->window) && !do_aggregate(self, topic->window))
+    {
+        return 0;
+    }
+    else if ((NULL == topic->window) && (NULL != topic->series)
+             && !do_encode(self, topic->series))
+    {
+        return 0;
     }
-    Debug_LOG_INFO("MQTT publish on WAN successful");
+
+    // the message is published by the drain loop, which keeps the frame until
+    // this has been successful
+    self->tmpDataPublish.isPending = true;
 
     return 0;
 }
@@ -371,155 +817,411 @@ static int handle_MQTT_PUBLISH(CC_FSM_t* self)
 //------------------------------------------------------------------------------
 static int handle_CC_FSM_INIT(CC_FSM_t* self)
 {
+    // the parameters are looked up one by one if this fails
+    OS_Error_t ret = helper_func_prefetchConfigParameters(
+                         &configBatch,
+                         CONFIG_DOMAIN_CLOUDCONNECTOR,
+                         configParameterNames,
+                         sizeof(configParameterNames)
+                         / sizeof(configParameterNames[0]));
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("helper_func_prefetchConfigParameters() failed with :%d",
+                          ret);
+    }
 
-    OS_Error_t ret = helper_func_getConfigParameter(&hConfig,
-                                                    DOMAIN_CLOUDCONNECTOR,
-                                                    SERVER_ADDRESS_NAME,
-                                                    &serverIP,
-                                                    sizeof(serverIP));
+    ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_CLOUDSERVICEIP,
+              &serverIP,
+              sizeof(serverIP));
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
-                        SERVER_ADDRESS_NAME, ret);
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_CLOUDSERVICEIP_NAME, ret);
         return ret;
     }
 
-    uint32_t serverPort;
-    ret = helper_func_getConfigParameter(&hConfig,
-                                         DOMAIN_CLOUDCONNECTOR,
-                                         SERVER_PORT_NAME,
-                                         &serverPort,
-                                         sizeof(serverPort));
+    ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_SERVERPORT,
+              &serverPort,
+              sizeof(serverPort));
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
-                        SERVER_PORT_NAME, ret);
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_SERVERPORT_NAME, ret);
         return ret;
     }
 
-    ret = helper_func_getConfigParameter(&hConfig,
-                                         DOMAIN_CLOUDCONNECTOR,
-                                         SERVER_CA_CERT_NAME,
-                                         &serverCert,
-                                         sizeof(serverCert));
+    ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_CLOUDCONNECTOR_SERVERCACERT,
+              &serverCert,
+              sizeof(serverCert));
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
-                        SERVER_CA_CERT_NAME, ret);
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_CLOUDCONNECTOR_SERVERCACERT_NAME, ret);
         return ret;
     }
 
-    Debug_LOG_DEBUG("Setting MQTT options ..." );
-    MQTTPacket_connectData options = MQTTPacket_connectData_initializer;
-    ret = set_mqtt_options(&options);
+    ret = init_rules(self);
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("set_mqtt_options() failed with code %d", ret);
+        Debug_LOG_ERROR("init_rules() failed with code %d", ret);
         return ret;
     }
 
-    Debug_LOG_INFO("Setting TLS to IP:%s Port:%u ...", serverIP, serverPort);
-    ret = glue_tls_init(serverIP, serverCert, sizeof(serverCert), serverPort);
+    ret = init_aggregation(self);
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("glue_tls_init() failed with code %d", ret);
+        Debug_LOG_ERROR("init_aggregation() failed with code %d", ret);
         return ret;
     }
 
-    Debug_LOG_INFO("Establishing TLS session... ");
-    ret = do_tls_handshake();
+    ret = init_encoding(self);
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("do_tls_handshake() failed with code %d", ret);
+        Debug_LOG_ERROR("init_encoding() failed with code %d", ret);
         return ret;
     }
-    Debug_LOG_INFO("TLS session established successfully");
 
-    Debug_LOG_INFO("Establishing MQTT connection... ");
-    ret = do_mqtt_connect(&self->paho.client, &options);
-    if (ret != 0)
+    Debug_LOG_DEBUG("Setting MQTT options ..." );
+    MQTTPacket_connectData options = MQTTPacket_connectData_initializer;
+    self->wan.options = options;
+    ret = set_mqtt_options(&self->wan.options);
+    if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("do_mqtt_connect() failed with code %d", ret);
+        Debug_LOG_ERROR("set_mqtt_options() failed with code %d", ret);
         return ret;
     }
 
+    // the connection to the broker is established by the WAN loop in run()
     Debug_LOG_INFO("CloudConnector initialized" );
 
-    //Unblock the cloudConnector_rpc_write
-    ret = sem_post();
-    if (ret != 0)
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+static int handle_CC_FSM_NEW_MESSAGE(CC_FSM_t* self,
+                                     size_t client,
+                                     const void* frame,
+                                     size_t frameLen)
+{
+    Debug_LOG_DEBUG("New message received from client %zu", client);
+
+    // the record is copied out of the frame, the client can't change it while
+    // it is processed
+    sensor_record_t record;
+    const void* data;
+    OS_Error_t err = sensor_record_read(frame, frameLen, &record, &data);
+    if (err != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("sem_post() failed with code %d", ret);
-        return ret;
+        Debug_LOG_ERROR("sensor_record_read() failed with %d, record dropped",
+                        err);
+        return 0;
     }
 
-    return 0;
+    if (SENSOR_RECORD_TYPE_TOPIC == record.type)
+    {
+        return handle_RECORD_TOPIC(self, client, &record, data);
+    }
+
+    return handle_RECORD_READING(self, client, &record, data);
 }
 
 //------------------------------------------------------------------------------
-static int handle_CC_FSM_NEW_MESSAGE(CC_FSM_t* self)
+// Move the frames from the rings into the early queue while booting. The order
+// of the frames is kept. If the queue is full, the frames stay in the rings.
+static void do_early_enqueue(CC_FSM_t* self)
 {
-    const char* receivedBuf = (const char*) sensor_port;
-    CC_FSM_PAHO_NetCtx_t* netCtx_server = &(self->paho.server_netCtx);
+    if (!self->early.isActive)
+    {
+        return;
+    }
 
-    Debug_LOG_INFO("New message received from client", __func__);
+    for (;;)
+    {
+        size_t client;
+        const void* frame;
+        size_t frameLen;
+        OS_Error_t err = client_sched_next(&self->sched, &client, &frame,
+                                           &frameLen);
+        if (err == OS_ERROR_NO_DATA)
+        {
+            return;
+        }
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("ring of client %zu failed with %d", client, err);
+            continue;
+        }
+
+        msg_ring_t* ring = client_sched_getRing(&self->sched, client);
+        if (frameLen > sizeof(self->early.frame) - sizeof(uint64_t))
+        {
+            Debug_LOG_ERROR("frame of %zu bytes too large, dropped", frameLen);
+            msg_ring_release(ring);
+            continue;
+        }
+
+        // the client number is put in front, the record stays aligned
+        uint64_t id = client;
+        memcpy(self->early.frame, &id, sizeof(id));
+        memcpy(&self->early.frame[sizeof(id)], frame, frameLen);
+
+        err = msg_ring_enqueue(&self->early.ring, self->early.frame,
+                               sizeof(id) + frameLen, NULL);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_WARNING("early queue full, %zu message(s) queued",
+                              self->early.numQueued);
+            return;
+        }
+
+        msg_ring_release(ring);
+        self->early.numQueued++;
+    }
+}
 
-    memcpy(netCtx_server->readBuff, receivedBuf, sizeof(netCtx_server->readBuff));
+//------------------------------------------------------------------------------
+// Sleep for the given time. While booting, the rings are emptied meanwhile.
+static void do_wait(CC_FSM_t* self, uint32_t ms)
+{
+    while (ms > 0)
+    {
+        uint32_t slice = (self->early.isActive && (ms > EARLY_POLL_MS))
+                         ? EARLY_POLL_MS : ms;
+
+        OS_Error_t err = TimeServer_sleep(&timer,
+                                          TimeServer_PRECISION_MSEC,
+                                          slice);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_WARNING("TimeServer_sleep() failed with %d", err);
+        }
+        ms -= slice;
+
+        do_early_enqueue(self);
+    }
+}
 
-    int packet_type = MQTTServer_readType(&self->paho.server);
+//------------------------------------------------------------------------------
+// Get the next frame to forward, frames of the early queue come first. The
+// frame must be released in the returned ring.
+static OS_Error_t do_next_frame(CC_FSM_t* self,
+                                msg_ring_t** ring,
+                                size_t* client,
+                                const void** frame,
+                                size_t* frameLen)
+{
+    const void* buf;
+    size_t len;
+    if (OS_SUCCESS == msg_ring_peek(&self->early.ring, &buf, &len, NULL))
+    {
+        uint64_t id;
+        memcpy(&id, buf, sizeof(id));
+
+        *ring     = &self->early.ring;
+        *client   = (size_t)id;
+        *frame    = (const uint8_t*)buf + sizeof(id);
+        *frameLen = len - sizeof(id);
+        return OS_SUCCESS;
+    }
 
-    int ret;
-    switch (packet_type)
+    OS_Error_t err = client_sched_next(&self->sched, client, frame, frameLen);
+    if (err == OS_SUCCESS)
     {
-    //------------------------------------------------
-    case CONNECT:
-        ret = handle_MQTT_CONNECT(self);
-        break;
-    //------------------------------------------------
-    case PINGREQ:
-        ret = handle_MQTT_PINGREQ(self);
-        break;
-    //------------------------------------------------
-    case PUBLISH:
-        ret = handle_MQTT_PUBLISH(self);
-        break;
-    //------------------------------------------------
-    case SUBSCRIBE:
-        ret = handle_MQTT_SUBSCRIBE(self);
-        break;
-    //------------------------------------------------
-    case CONNACK:
-    case PUBACK:
-    case PUBREC:
-    case PUBREL:
-    case PUBCOMP:
-    case SUBACK:
-    case UNSUBSCRIBE:
-    case UNSUBACK:
-    case PINGRESP:
-    case DISCONNECT:
-        ret = handle_MQTT_unsupportedPacket(self, packet_type);
-        break;
-    //------------------------------------------------
-    default:
-        Debug_LOG_ERROR("received invalid data, found packet type %d, abort",
-                        packet_type);
-
-        // we've received unknown data. The packet parser might be out of
-        // sync now, because it reads two byte at once at least. So we
-        // could be out of sync now and never re-sync.
-        ret = -1;
-        break;
+        *ring = client_sched_getRing(&self->sched, *client);
     }
 
-    ret = sem_post();
-    if (ret != 0)
+    return err;
+}
+
+//------------------------------------------------------------------------------
+// Re-establish the connection to the broker. The delay before an attempt grows
+// exponentially, while the Sensor keeps enqueuing messages into the ring.
+static int handle_CC_FSM_WAN_DOWN(CC_FSM_t* self)
+{
+    // nothing is forwarded until the connection is back, the Sensors slow
+    // down at once instead of relying on the last measured rate
+    uint64_t now_ms = glue_tls_mqtt_getTimeMs();
+    for (size_t i = 0; i < CLOUDCONNECTOR_NUM_CLIENTS; i++)
     {
-        Debug_LOG_ERROR("sem_post() failed with code %d", ret);
-        return ret;
+        msg_ring_resetDrainRate(&self->sensorRings[i], now_ms);
     }
 
-    return 0;
+    if (self->wan.retry_ms > 0)
+    {
+        Debug_LOG_INFO("Reconnecting to broker in %u ms", self->wan.retry_ms);
+        do_wait(self, self->wan.retry_ms);
+    }
+
+    // the delay is reset only after a successful publish, so a broker that
+    // accepts the connection but drops it again is not hammered
+    self->wan.retry_ms = (0 == self->wan.retry_ms) ? WAN_RETRY_MS_MIN
+                         : self->wan.retry_ms * 2;
+    if (self->wan.retry_ms > WAN_RETRY_MS_MAX)
+    {
+        self->wan.retry_ms = WAN_RETRY_MS_MAX;
+    }
+
+    do_early_enqueue(self);
+    int ret = do_wan_connect(self);
+    if ((0 == ret) && self->early.isActive)
+    {
+        // from now on, the frames stay in the rings while the WAN is down
+        Debug_LOG_INFO("first session established, %zu early message(s) "
+                       "queued", self->early.numQueued);
+        self->early.isActive = false;
+    }
+
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// The drain rates are the backpressure signal for the Sensors, they adapt their
+// sampling rate to it. Updating them takes a call to the TimeServer, so this
+// is done after a publish, which takes much longer anyway, and after draining.
+static void do_update_drain_rates(CC_FSM_t* self)
+{
+    uint64_t now_ms = glue_tls_mqtt_getTimeMs();
+    for (size_t i = 0; i < CLOUDCONNECTOR_NUM_CLIENTS; i++)
+    {
+        msg_ring_updateDrainRate(&self->sensorRings[i], now_ms);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Process all messages that are in the ring. The Sensor can enqueue further
+// messages meanwhile, these are processed in the same batch. A frame is
+// released only when its message has been published or dropped, so the Sensor
+// can query the delivery with the sequence number of the frame.
+static void handle_CC_FSM_DRAIN(CC_FSM_t* self)
+{
+    for (;;)
+    {
+        // a message that could not be published is retried first, its frame
+        // is still in the ring
+        if (self->tmpDataPublish.isPending)
+        {
+            if (!MQTT_client_isConnected(&self->paho.client)
+                || (do_wan_publish(self) != 0))
+            {
+                return;
+            }
+            msg_ring_release(self->tmpDataPublish.ring);
+            do_update_drain_rates(self);
+        }
+
+        msg_ring_t* ring;
+        size_t client;
+        const void* frame;
+        size_t frameLen;
+        OS_Error_t err = do_next_frame(self, &ring, &client, &frame, &frameLen);
+        if (err == OS_ERROR_NO_DATA)
+        {
+            break;
+        }
+        if (err != OS_SUCCESS)
+        {
+            // the client is not served any longer, the others continue
+            Debug_LOG_ERROR("ring of client %zu failed with %d", client, err);
+            continue;
+        }
+
+        int ret = handle_CC_FSM_NEW_MESSAGE(self, client, frame, frameLen);
+        if (ret != 0)
+        {
+            Debug_LOG_ERROR("handle_CC_FSM_NEW_MESSAGE() failed with %d", ret);
+        }
+
+        if (self->tmpDataPublish.isPending)
+        {
+            self->tmpDataPublish.ring = ring;
+        }
+        else
+        {
+            msg_ring_release(ring);
+        }
+    }
+
+    do_update_drain_rates(self);
+
+    Debug_LOG_INFO("Waiting for new message from client...");
+}
+
+//------------------------------------------------------------------------------
+// Apply a new broker address or CA certificate from the ConfigServer. The
+// session is closed after the last publish and re-established at once with
+// the new parameters, the messages that are queued meanwhile stay in the
+// rings. The current parameters are kept if the new ones can't be read.
+static void handle_CC_FSM_CONFIG_CHANGED(CC_FSM_t* self)
+{
+    static char newServerCert[SERVER_CERT_SIZE];
+
+    if (!configChanged_notify_poll())
+    {
+        return;
+    }
+
+    if (!helper_func_isConfigParameterChanged(
+            CONFIG_PARAM_CLOUDCONNECTOR_CLOUDSERVICEIP)
+        && !helper_func_isConfigParameterChanged(
+            CONFIG_PARAM_CLOUDCONNECTOR_SERVERPORT)
+        && !helper_func_isConfigParameterChanged(
+            CONFIG_PARAM_CLOUDCONNECTOR_SERVERCACERT))
+    {
+        return;
+    }
+
+    char newServerIP[SERVER_IP_SIZE] = {0};
+    uint32_t newServerPort;
+    memset(newServerCert, 0, sizeof(newServerCert));
+
+    OS_Error_t ret = helper_func_getConfigParameterById(
+                         &hConfig,
+                         CONFIG_PARAM_CLOUDCONNECTOR_CLOUDSERVICEIP,
+                         newServerIP,
+                         sizeof(newServerIP) - 1);
+    if (ret == OS_SUCCESS)
+    {
+        ret = helper_func_getConfigParameterById(
+                  &hConfig,
+                  CONFIG_PARAM_CLOUDCONNECTOR_SERVERPORT,
+                  &newServerPort,
+                  sizeof(newServerPort));
+    }
+    if (ret == OS_SUCCESS)
+    {
+        ret = helper_func_getConfigParameterById(
+                  &hConfig,
+                  CONFIG_PARAM_CLOUDCONNECTOR_SERVERCACERT,
+                  newServerCert,
+                  sizeof(newServerCert) - 1);
+    }
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("new broker parameters not applied, lookup failed "
+                          "with :%d", ret);
+        return;
+    }
+
+    memcpy(serverIP, newServerIP, sizeof(serverIP));
+    serverPort = newServerPort;
+    memcpy(serverCert, newServerCert, sizeof(serverCert));
+
+    Debug_LOG_INFO("Switching to broker IP:%s Port:%u", serverIP, serverPort);
+
+    if (MQTT_client_isConnected(&self->paho.client))
+    {
+        MQTT_client_disconnect(&self->paho.client);
+        glue_tls_close();
+    }
+
+    // this is no loss of the connection, so it is re-established at once
+    self->wan.retry_ms = 0;
 }
 
 //==============================================================================
@@ -561,42 +1263,44 @@ int CC_FSM_ctor()
                      netCtx_client->readBuff,
                      sizeof(netCtx_client->readBuff) );
 
-    CC_FSM_PAHO_NetCtx_t* netCtx_server = &(self->paho.server_netCtx);
-
-    Network* net_lan = &(netCtx_server->net);
+    MQTT_client_setResponseTimeout(&self->paho.client,
+                                   PAHO_TIMEOUT_MS_RTO_INITIAL,
+                                   PAHO_TIMEOUT_MS_RTO_MIN,
+                                   PAHO_TIMEOUT_MS_RTO_MAX);
 
-    MQTTServerInit(&self->paho.server,
-                   net_lan,
-                   PAHO_TIMEOUT_MS_COMMAND,
-                   netCtx_server->sendBuff,
-                   sizeof(netCtx_server->sendBuff),
-                   netCtx_server->readBuff,
-                   sizeof(netCtx_server->readBuff) );
+    client_sched_init(&self->sched);
 
-    return 0;
-}
-
-OS_Error_t
-cloudConnector_rpc_write()
-{
-    CC_FSM_t* self = &cc_fsm;
-
-    OS_Error_t ret = sem_wait();
-    if (ret)
+    for (size_t i = 0; i < CLOUDCONNECTOR_NUM_CLIENTS; i++)
     {
-        Debug_LOG_ERROR("Failed to wait on semaphore, error %d", ret);
+        err = msg_ring_init(&self->sensorRings[i],
+                            OS_Dataport_getBuf(sensorPorts[i]),
+                            OS_Dataport_getSize(sensorPorts[i]));
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("msg_ring_init() failed for client %zu with: %d",
+                            i, err);
+            return -1;
+        }
+
+        err = client_sched_addClient(&self->sched, &self->sensorRings[i],
+                                     clientWeights[i]);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("client_sched_addClient() failed for client %zu "
+                            "with: %d", i, err);
+            return -1;
+        }
     }
 
-    ret = handle_CC_FSM_NEW_MESSAGE(self);
-    if (ret != OS_SUCCESS)
+    err = msg_ring_init(&self->early.ring, earlyQueueBuf, sizeof(earlyQueueBuf));
+    if (err != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("handle_CC_FSM_NEW_MESSAGE() failed with %d", ret);
-        return OS_ERROR_GENERIC;
+        Debug_LOG_ERROR("msg_ring_init() failed for early queue with: %d", err);
+        return -1;
     }
+    self->early.isActive = true;
 
-    Debug_LOG_INFO("Waiting for new message from client...");
-
-    return OS_SUCCESS;
+    return 0;
 }
 
 //------------------------------------------------------------------------------
@@ -607,6 +1311,9 @@ int run()
 
     CC_FSM_t* self = &cc_fsm;
 
+#if defined(DEMO_IOT_BENCHMARK)
+    benchmark_CloudConnector_run();
+#endif
 
     int ret = CC_FSM_ctor();
     if (ret != 0)
@@ -615,6 +1322,11 @@ int run()
         return -1;
     }
 
+    // the config is fetched and the session is established meanwhile, the
+    // Sensors start right away
+    do_early_enqueue(self);
+
+    uint64_t init_ms = glue_tls_mqtt_getTimeMs();
     ret = handle_CC_FSM_INIT(self);
     if (ret != 0)
     {
@@ -622,5 +1334,35 @@ int run()
         return -1;
     }
 
+    helper_func_configStats_t configStats;
+    helper_func_getConfigStats(&configStats);
+    Debug_LOG_INFO("config: %u lookups, %u from cache, %u RPCs, init took %"
+                   PRIu64 " ms", configStats.lookups, configStats.hits,
+                   configStats.rpcs, glue_tls_mqtt_getTimeMs() - init_ms);
+
+    // This is the WAN thread, it owns the TLS session. The Sensor never waits
+    // for it, messages that are enqueued while the connection is down or slow
+    // are processed as soon as possible.
+    for (;;)
+    {
+        if (!MQTT_client_isConnected(&self->paho.client))
+        {
+            if (handle_CC_FSM_WAN_DOWN(self) != 0)
+            {
+                continue;
+            }
+        }
+
+        handle_CC_FSM_DRAIN(self);
+
+        // changes are applied when the client wakes the WAN thread up
+        handle_CC_FSM_CONFIG_CHANGED(self);
+
+        if (MQTT_client_isConnected(&self->paho.client))
+        {
+            sensor_notify_wait();
+        }
+    }
+
     return 0;
 }
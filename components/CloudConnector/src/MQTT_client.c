@@ -15,6 +15,10 @@
 
 #define MAX_PACKET_ID   65535 // according to the MQTT specification
 
+// Timers only count down, so a round trip is measured as the time that has
+// elapsed on a timer started with this value.
+#define RTT_MEASUREMENT_MAX_MS  (1000 * 60 * 60)
+
 
 //------------------------------------------------------------------------------
 static int getNextPacketId(
@@ -36,6 +40,25 @@ static int getNextPacketId(
 }
 
 
+//------------------------------------------------------------------------------
+static void startRttMeasurement(
+    Timer* timer
+)
+{
+    TimerInit(timer);
+    TimerCountdownMS(timer, RTT_MEASUREMENT_MAX_MS);
+}
+
+
+//------------------------------------------------------------------------------
+static unsigned int getElapsedMs(
+    Timer* timer
+)
+{
+    return RTT_MEASUREMENT_MAX_MS - TimerLeftMS(timer);
+}
+
+
 //------------------------------------------------------------------------------
 static void closeSession(
     MQTT_client_t* self
@@ -48,10 +71,12 @@ static void closeSession(
 
 
 //------------------------------------------------------------------------------
-// send a packet and update the keep alive mechanism if successful
-static int sendPacket(
+// send a packet from the given segments and update the keep alive mechanism if
+// successful
+static int sendPacketVec(
     MQTT_client_t* self,
-    unsigned int length
+    const MQTT_iovec_t* iov,
+    unsigned int iovCnt
 )
 {
     Timer myTimer;
@@ -63,14 +88,28 @@ static int sendPacket(
         timer = &myTimer;
     }
 
-    return MQTT_network_sendPacket(self->net, self->sendbuf, length, timer);
+    int ret = MQTT_network_sendPacketVec(self->net, iov, iovCnt, timer);
 
     // update timer for keep-alive mechanism
-    if (self->keepAliveInterval_ms != 0)
+    if ((ret == MQTT_SUCCESS) && (self->keepAliveInterval_ms != 0))
     {
         TimerCountdown(&self->timerLastSend, self->keepAliveInterval_ms);
     }
 
+    return ret;
+}
+
+
+//------------------------------------------------------------------------------
+// send a packet that has been serialized into sendbuf
+static int sendPacket(
+    MQTT_client_t* self,
+    unsigned int length
+)
+{
+    const MQTT_iovec_t iov = { .buffer = self->sendbuf, .length = length };
+
+    return sendPacketVec(self, &iov, 1);
 }
 
 
@@ -153,6 +192,7 @@ static int sendPingReq(
     }
 
     self->isPingOutstanding = 1;
+    startRttMeasurement(&self->timerPing);
     return MQTT_SUCCESS;
 }
 
@@ -190,6 +230,9 @@ static int sendAck(
 
 
 //------------------------------------------------------------------------------
+// Only the fixed header, the topic and the packet id are serialized into
+// sendbuf, the payload is sent from the caller's buffer as a separate segment.
+// This saves copying the payload and allows payloads larger than sendbuf.
 static int sendPublish(
     MQTT_client_t* self,
     unsigned char dup,
@@ -204,27 +247,44 @@ static int sendPublish(
     MQTTString topic = MQTTString_initializer;
     topic.cstring = (char*)topicName;
 
-    int len = MQTTSerialize_publish(self->sendbuf,
-                                    self->sendbuf_size,
-                                    dup,
-                                    qos,
-                                    retained,
-                                    packetId,
-                                    topic,
-                                    payload,
-                                    payloadLen);
-    if (len <= 0)
+    // variable header is the topic and the packet id for QoS 1 and 2
+    int varHeaderLen = 2 + MQTTstrlen(topic) + ((qos > 0) ? 2 : 0);
+    int remLen = varHeaderLen + payloadLen;
+
+    // 1 byte packet type, up to 4 bytes remaining length
+    if ((payloadLen < 0) || ((size_t)(1 + 4 + varHeaderLen) > self->sendbuf_size))
     {
-        Debug_LOG_ERROR("%s(): MQTTSerialize_publish() failed with code %d", __func__,
-                        len);
+        Debug_LOG_ERROR("%s(): header for topic '%s' does not fit into buffer",
+                        __func__, topicName);
         return MQTT_FAILURE;
     }
 
-    int ret = sendPacket(self, len);
+    MQTTHeader header = {0};
+    header.bits.type = PUBLISH;
+    header.bits.dup = dup;
+    header.bits.qos = qos;
+    header.bits.retain = retained;
+
+    unsigned char* ptr = self->sendbuf;
+    writeChar(&ptr, header.byte);
+    ptr += MQTTPacket_encode(ptr, remLen);
+    writeMQTTString(&ptr, topic);
+    if (qos > 0)
+    {
+        writeInt(&ptr, packetId);
+    }
+
+    const MQTT_iovec_t iov[] =
+    {
+        { .buffer = self->sendbuf, .length = ptr - self->sendbuf },
+        { .buffer = payload,       .length = payloadLen },
+    };
+
+    int ret = sendPacketVec(self, iov, sizeof(iov) / sizeof(iov[0]));
     if (ret != MQTT_SUCCESS)
     {
-        Debug_LOG_ERROR("%s(): MQTT_client_sendPacket() failed with code %d", __func__,
-                        len);
+        Debug_LOG_ERROR("%s(): sendPacketVec() failed with code %d", __func__,
+                        ret);
         return MQTT_FAILURE;
     }
 
@@ -265,6 +325,10 @@ int waitForNextPacket(
         switch (packetType)
         {
         case PINGRESP:
+            if (self->isPingOutstanding)
+            {
+                rtt_estimator_addSample(&self->rtt, getElapsedMs(&self->timerPing));
+            }
             self->isPingOutstanding = 0;
             break;
 
@@ -273,16 +337,22 @@ int waitForNextPacket(
         }
     }
 
+    // the response to a PING is expected within the response timeout,
+    // otherwise the connection is considered dead
+    if (    self->isPingOutstanding
+            && (getElapsedMs(&self->timerPing)
+                > rtt_estimator_getTimeout(&self->rtt)) )
+    {
+        Debug_LOG_ERROR("%s(): no PINGRESP within %u ms", __func__,
+                        rtt_estimator_getTimeout(&self->rtt));
+        rtt_estimator_backoff(&self->rtt);
+        return MQTT_FAILURE;
+    }
+
     if (    (self->keepAliveInterval_ms != 0)
+            && !self->isPingOutstanding
             && TimerIsExpired(&self->timerLastSend) )
     {
-        // seems we've reached the timeout already and expect a response,
-        // but it did not arrive. So the connection is considered dead
-        if (self->isPingOutstanding)
-        {
-            return MQTT_FAILURE;
-        }
-
         // send a new ping packet to show we are alive
         int ret = sendPingReq(self);
         if (ret != MQTT_SUCCESS)
@@ -516,6 +586,19 @@ int MQTT_client_connect(
         return MQTT_FAILURE;
     }
 
+    // There is no round trip estimate before the first exchange and the broker
+    // may have to authenticate the client, so allow the maximum here.
+    Timer tmpTimer;
+    if (timer == NULL)
+    {
+        TimerInit(&tmpTimer);
+        TimerCountdownMS(&tmpTimer, self->rtt.max_ms);
+        timer = &tmpTimer;
+    }
+
+    Timer rttTimer;
+    startRttMeasurement(&rttTimer);
+
     ret = waitForSpecificPacket(self, CONNACK, timer);
     if (ret != MQTT_SUCCESS)
     {
@@ -524,6 +607,8 @@ int MQTT_client_connect(
         return MQTT_FAILURE;
     }
 
+    rtt_estimator_addSample(&self->rtt, getElapsedMs(&rttTimer));
+
     data->rc = 0;
     data->sessionPresent = 0;
 
@@ -583,14 +668,37 @@ int MQTT_client_publish(
         return MQTT_FAILURE;
     }
 
+    // without a timer from the caller, the acknowledgement is expected within
+    // the adaptive response timeout
+    Timer tmpTimer;
+    if (timer == NULL)
+    {
+        TimerInit(&tmpTimer);
+        TimerCountdownMS(&tmpTimer, rtt_estimator_getTimeout(&self->rtt));
+        timer = &tmpTimer;
+    }
+
+    Timer rttTimer;
+    startRttMeasurement(&rttTimer);
+
     ret = checkPublishQos(self, msg->qos, timer);
     if (ret != MQTT_SUCCESS)
     {
         Debug_LOG_ERROR("%s(): checkPublishQOS() failed with code %d", __func__, ret);
+        if (TimerIsExpired(timer))
+        {
+            rtt_estimator_backoff(&self->rtt);
+        }
         closeSession(self);
         return MQTT_FAILURE;
     }
 
+    // with QoS 2 there are two round trips, only QoS 1 gives a clean sample
+    if (msg->qos == 1)
+    {
+        rtt_estimator_addSample(&self->rtt, getElapsedMs(&rttTimer));
+    }
+
     return MQTT_SUCCESS;
 }
 
@@ -613,6 +721,15 @@ void MQTT_client_disconnect(
 }
 
 
+//------------------------------------------------------------------------------
+int MQTT_client_isConnected(
+    MQTT_client_t* self
+)
+{
+    return self->isConnected;
+}
+
+
 //------------------------------------------------------------------------------
 void MQTT_client_init(
     MQTT_client_t* self,
@@ -644,4 +761,23 @@ void MQTT_client_init(
     self->isConnected = 0;
     self->isPingOutstanding = 0;
     self->nextPacketId = 1;
+
+    // until configured otherwise, responses are expected within the send
+    // timeout
+    rtt_estimator_init(&self->rtt, send_timeout_ms, 1, send_timeout_ms);
+    TimerInit(&self->timerPing);
+}
+
+
+//------------------------------------------------------------------------------
+void MQTT_client_setResponseTimeout(
+    MQTT_client_t* self,
+    unsigned int initial_ms,
+    unsigned int min_ms,
+    unsigned int max_ms
+)
+{
+    Debug_ASSERT_SELF(self);
+
+    rtt_estimator_init(&self->rtt, initial_ms, min_ms, max_ms);
 }
@@ -21,6 +21,8 @@
 
 #include "MQTTPacket.h"
 
+#include "rtt_estimator.h"
+
 #define NUM_MQTT_CLIENT_MESSAGE_HANDLERS    1
 
 
@@ -63,6 +65,8 @@ typedef struct
     int isPingOutstanding;
     int isConnected;
     Timer timerLastSend;
+    Timer timerPing;
+    rtt_estimator_t rtt;
 } MQTT_client_t;
 
 
@@ -77,6 +81,17 @@ void MQTT_client_init(
 );
 
 
+// Set the bounds of the adaptive response timeout. It is derived from the
+// round trip times measured for CONNECT->CONNACK, PUBLISH->PUBACK and
+// PINGREQ->PINGRESP and used whenever no timer is passed to a function.
+void MQTT_client_setResponseTimeout(
+    MQTT_client_t* self,
+    unsigned int initial_ms,
+    unsigned int min_ms,
+    unsigned int max_ms
+);
+
+
 int MQTT_client_connect(
     MQTT_client_t* self,
     MQTTPacket_connectData* options,
@@ -93,3 +108,6 @@ int MQTT_client_publish(
 
 void MQTT_client_disconnect(
     MQTT_client_t* self);
+
+int MQTT_client_isConnected(
+    MQTT_client_t* self);
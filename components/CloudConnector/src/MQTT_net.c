@@ -74,6 +74,37 @@ int MQTT_network_sendPacket(
 }
 
 
+//------------------------------------------------------------------------------
+// send a packet from given segments to a Network object. The timer covers the
+// whole packet, not each segment.
+int MQTT_network_sendPacketVec(
+    Network* n,
+    const MQTT_iovec_t* iov,
+    unsigned int iovCnt,
+    Timer* timer
+)
+{
+    for (unsigned int i = 0; i < iovCnt; i++)
+    {
+        // writing 0 bytes may be seen as an undefined operation
+        if (iov[i].length == 0)
+        {
+            continue;
+        }
+
+        int ret = MQTT_network_write(n, iov[i].buffer, iov[i].length, timer);
+        if (ret != MQTT_SUCCESS)
+        {
+            Debug_LOG_ERROR("network_write() for segment %u of packet failed with: %d",
+                            i, ret);
+            return ret;
+        }
+    }
+
+    return MQTT_SUCCESS;
+}
+
+
 //------------------------------------------------------------------------------
 // read a packet from the Network and get the decoded length. Return a positive
 // value with the number of length bytes read or a negative value indicating an
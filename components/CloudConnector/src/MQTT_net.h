@@ -26,6 +26,14 @@ enum
 };
 
 
+// a segment of a packet that is sent with MQTT_network_sendPacketVec()
+typedef struct
+{
+    const unsigned char* buffer;
+    unsigned int length;
+} MQTT_iovec_t;
+
+
 int MQTT_network_read(
     Network* n,
     unsigned char* buffer,
@@ -47,6 +55,16 @@ int MQTT_network_sendPacket(
     Timer* timer
 );
 
+// send a packet that consists of several segments. Each segment is written
+// from where it lives, so the packet does not have to be assembled in a
+// contiguous buffer first.
+int MQTT_network_sendPacketVec(
+    Network* n,
+    const MQTT_iovec_t* iov,
+    unsigned int iovCnt,
+    Timer* timer
+);
+
 int MQTT_network_readPacket(
     Network* n,
     unsigned char* buffer,
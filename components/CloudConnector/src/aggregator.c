@@ -0,0 +1,256 @@
+/*
+ * Windowed aggregation of numeric samples per topic
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "aggregator.h"
+#include "cfg_text.h"
+
+#include "lib_debug/Debug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+static void
+acc_reset(
+    aggregator_acc_t* acc)
+{
+    memset(acc, 0, sizeof(*acc));
+}
+
+//------------------------------------------------------------------------------
+static void
+acc_add(
+    aggregator_acc_t*   acc,
+    double              value)
+{
+    if ((0 == acc->count) || (value < acc->min))
+    {
+        acc->min = value;
+    }
+    if ((0 == acc->count) || (value > acc->max))
+    {
+        acc->max = value;
+    }
+    acc->sum += value;
+    acc->count++;
+}
+
+//------------------------------------------------------------------------------
+static void
+acc_merge(
+    aggregator_acc_t*       acc,
+    const aggregator_acc_t* other)
+{
+    if (0 == other->count)
+    {
+        return;
+    }
+    if ((0 == acc->count) || (other->min < acc->min))
+    {
+        acc->min = other->min;
+    }
+    if ((0 == acc->count) || (other->max > acc->max))
+    {
+        acc->max = other->max;
+    }
+    acc->sum += other->sum;
+    acc->count += other->count;
+}
+
+//------------------------------------------------------------------------------
+// Move the current pane into the window and return the summary of the window
+// that ends with it. This is O(numPanes), but happens once per hop only.
+static bool
+close_pane(
+    aggregator_window_t*    window,
+    aggregator_summary_t*   summary)
+{
+    window->panes[window->paneHead] = window->current;
+    window->paneHead = (window->paneHead + 1) % window->numPanes;
+
+    uint64_t end_ms = window->currentStart_ms + window->hop_ms;
+
+    acc_reset(&window->current);
+    window->currentStart_ms = end_ms;
+
+    aggregator_acc_t total;
+    acc_reset(&total);
+    for (unsigned int i = 0; i < window->numPanes; i++)
+    {
+        acc_merge(&total, &window->panes[i]);
+    }
+
+    if (0 == total.count)
+    {
+        return false;
+    }
+
+    summary->start_ms   = (end_ms > window->window_ms) ?
+                          (end_ms - window->window_ms) : 0;
+    summary->end_ms     = end_ms;
+    summary->count      = total.count;
+    summary->min        = total.min;
+    summary->max        = total.max;
+    summary->mean       = total.sum / total.count;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static OS_Error_t
+parse_line(
+    aggregator_window_t*    window,
+    const char*             line)
+{
+    char type[16];
+    unsigned int window_ms = 0;
+    unsigned int hop_ms = 0;
+
+    int cnt = sscanf(line, "%127s %15s %u %u",
+                     window->topic, type, &window_ms, &hop_ms);
+    if (cnt < 3)
+    {
+        Debug_LOG_ERROR("invalid aggregation config line: '%s'", line);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if (0 == strcmp(type, "tumbling"))
+    {
+        hop_ms = window_ms;
+    }
+    else if ((0 != strcmp(type, "sliding")) || (cnt < 4))
+    {
+        Debug_LOG_ERROR("invalid window type or missing hop: '%s'", line);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if ((0 == hop_ms) || (window_ms % hop_ms != 0)
+        || (window_ms / hop_ms > AGGREGATOR_MAX_PANES))
+    {
+        Debug_LOG_ERROR("window %u ms is not a multiple of hop %u ms (max %u panes)",
+                        window_ms, hop_ms, AGGREGATOR_MAX_PANES);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    window->window_ms   = window_ms;
+    window->hop_ms      = hop_ms;
+    window->numPanes    = window_ms / hop_ms;
+
+    Debug_LOG_INFO("aggregating '%s' in %s windows of %u ms (hop %u ms)",
+                   window->topic, type, window_ms, hop_ms);
+
+    return OS_SUCCESS;
+}
+
+
+//==============================================================================
+// public functions
+//==============================================================================
+
+//------------------------------------------------------------------------------
+OS_Error_t
+aggregator_init(
+    aggregator_t*   self,
+    const char*     config,
+    size_t          configLen)
+{
+    Debug_ASSERT_SELF(self);
+    Debug_ASSERT(NULL != config);
+
+    memset(self, 0, sizeof(*self));
+
+    size_t pos = 0;
+    char line[AGGREGATOR_MAX_TOPIC_LEN + 64];
+    while (cfg_text_nextLine(config, configLen, &pos, line, sizeof(line)))
+    {
+        if (self->numWindows >= AGGREGATOR_MAX_TOPICS)
+        {
+            Debug_LOG_ERROR("too many aggregation windows, max is %u",
+                            AGGREGATOR_MAX_TOPICS);
+            return OS_ERROR_OUT_OF_BOUNDS;
+        }
+
+        OS_Error_t err = parse_line(&self->windows[self->numWindows], line);
+        if (OS_SUCCESS != err)
+        {
+            return err;
+        }
+        self->numWindows++;
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+aggregator_window_t*
+aggregator_find(
+    aggregator_t*   self,
+    const char*     topic)
+{
+    Debug_ASSERT_SELF(self);
+
+    for (size_t i = 0; i < self->numWindows; i++)
+    {
+        if (0 == strncmp(self->windows[i].topic, topic,
+                         sizeof(self->windows[i].topic)))
+        {
+            return &self->windows[i];
+        }
+    }
+
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+bool
+aggregator_addSample(
+    aggregator_window_t*    window,
+    uint64_t                now_ms,
+    double                  value,
+    aggregator_summary_t*   summary)
+{
+    Debug_ASSERT(NULL != window);
+    Debug_ASSERT(NULL != summary);
+
+    bool isClosed = false;
+
+    if (!window->isStarted)
+    {
+        window->currentStart_ms = now_ms;
+        window->isStarted = true;
+    }
+
+    // After numPanes empty hops all panes are empty, so there is no need to
+    // step through a longer gap pane by pane.
+    for (unsigned int i = 0;
+         (now_ms >= window->currentStart_ms + window->hop_ms);
+         i++)
+    {
+        if (i > window->numPanes)
+        {
+            uint64_t hops = (now_ms - window->currentStart_ms) / window->hop_ms;
+            window->currentStart_ms += hops * window->hop_ms;
+            break;
+        }
+
+        // on a gap several windows close at once, report the first one as the
+        // later ones only hold a subset of its samples
+        aggregator_summary_t tmp;
+        if (close_pane(window, &tmp) && !isClosed)
+        {
+            *summary = tmp;
+            isClosed = true;
+        }
+    }
+
+    acc_add(&window->current, value);
+
+    return isClosed;
+}
@@ -0,0 +1,91 @@
+/*
+ * Windowed aggregation of numeric samples per topic
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AGGREGATOR_MAX_TOPICS       4
+#define AGGREGATOR_MAX_TOPIC_LEN    128
+// A sliding window is split into panes of the hop size, so window_ms/hop_ms
+// must not exceed this.
+#define AGGREGATOR_MAX_PANES        16
+
+typedef struct
+{
+    size_t      count;
+    double      sum;
+    double      min;
+    double      max;
+} aggregator_acc_t;
+
+typedef struct
+{
+    uint64_t    start_ms;
+    uint64_t    end_ms;
+    size_t      count;
+    double      min;
+    double      max;
+    double      mean;
+} aggregator_summary_t;
+
+typedef struct
+{
+    char                topic[AGGREGATOR_MAX_TOPIC_LEN];
+    uint32_t            window_ms;
+    uint32_t            hop_ms; // equals window_ms for tumbling windows
+    unsigned int        numPanes;
+
+    // closed panes of the current window, oldest first starting at paneHead
+    aggregator_acc_t    panes[AGGREGATOR_MAX_PANES];
+    unsigned int        paneHead;
+
+    aggregator_acc_t    current;
+    uint64_t            currentStart_ms;
+    bool                isStarted;
+} aggregator_window_t;
+
+typedef struct
+{
+    aggregator_window_t windows[AGGREGATOR_MAX_TOPICS];
+    size_t              numWindows;
+} aggregator_t;
+
+// Set up the windows from a text configuration, one window per line:
+//
+//   <topic> tumbling <window_ms>
+//   <topic> sliding  <window_ms> <hop_ms>
+//
+// Empty lines and lines starting with '#' are ignored.
+OS_Error_t
+aggregator_init(
+    aggregator_t*   self,
+    const char*     config,
+    size_t          configLen);
+
+aggregator_window_t*
+aggregator_find(
+    aggregator_t*   self,
+    const char*     topic);
+
+// Add a sample to the window in O(1). Windows close lazily, i.e. when the
+// first sample after the end of a window arrives. Returns true if a non-empty
+// window closed and its summary was written to the given buffer, the sample
+// itself is accounted to the next window then.
+bool
+aggregator_addSample(
+    aggregator_window_t*    window,
+    uint64_t                now_ms,
+    double                  value,
+    aggregator_summary_t*   summary);
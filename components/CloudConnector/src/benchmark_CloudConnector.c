@@ -0,0 +1,482 @@
+/*
+ * Built-in benchmarks of the CloudConnector, they are run at startup if
+ * DEMO_IOT_BENCHMARK is defined in the system configuration.
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "lib_debug/Debug.h"
+
+#include "client_sched.h"
+#include "glue_tls_mqtt.h"
+#include "msg_ring.h"
+#include "rules.h"
+#include "sensor_record.h"
+#include "ts_batch.h"
+
+#include "MQTTPacket.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCHMARK_TRACE_SAMPLES     1024
+#define BENCHMARK_TRACE_PERIOD_MS   5000
+#define BENCHMARK_SAMPLES_PER_FRAME 64
+#define BENCHMARK_RULE_EVALUATIONS  200000
+#define BENCHMARK_CLIENT_ROUNDS     2000
+#define BENCHMARK_CLIENT_FRAME_SIZE 48
+#define BENCHMARK_CLIENT_QUIET      4   // frames per round of a quiet client
+#define BENCHMARK_CLIENT_RING_SIZE  4096
+#define BENCHMARK_RECORD_READS      200000
+#define BENCHMARK_BATCH_SAMPLES     (64 * 4096)
+
+
+//------------------------------------------------------------------------------
+// Synthetic temperature trace: a random walk in 0.1 degree steps, sampled every
+// 5 seconds with some jitter, like the Sensor would produce it.
+static void
+get_trace_sample(
+    unsigned int    idx,
+    uint32_t*       rng,
+    uint64_t*       timestamp_ms,
+    double*         value)
+{
+    static int32_t  tenthDegree = 230;
+    static uint64_t now_ms = 1000000;
+
+    *rng = (*rng * 1103515245) + 12345;
+    unsigned int r = (*rng >> 16) & 0x7FFF;
+
+    if (0 == idx)
+    {
+        tenthDegree = 230;
+        now_ms = 1000000;
+    }
+    else
+    {
+        if ((r % 8) == 0)
+        {
+            tenthDegree++;
+        }
+        else if ((r % 8) == 1)
+        {
+            tenthDegree--;
+        }
+        now_ms += BENCHMARK_TRACE_PERIOD_MS + (r % 3) - 1;
+    }
+
+    *timestamp_ms = now_ms;
+    *value = tenthDegree / 10.0;
+}
+
+//------------------------------------------------------------------------------
+static void
+benchmark_encoding(void)
+{
+    static ts_batch_t batch;
+    static uint8_t frame[TS_BATCH_FRAME_SIZE];
+    static uint64_t timestamps[BENCHMARK_SAMPLES_PER_FRAME];
+    static double values[BENCHMARK_SAMPLES_PER_FRAME];
+
+    char config[64];
+    snprintf(config, sizeof(config), "bench gorilla %u",
+             BENCHMARK_SAMPLES_PER_FRAME);
+
+    OS_Error_t err = ts_batch_init(&batch, config, sizeof(config));
+    if (OS_SUCCESS != err)
+    {
+        Debug_LOG_ERROR("ts_batch_init() failed with %d", err);
+        return;
+    }
+    ts_batch_series_t* series = ts_batch_find(&batch, "bench");
+
+    uint32_t rng = 42;
+    size_t textBytes = 0;
+    size_t encodedBytes = 0;
+    size_t numFrames = 0;
+    size_t numInFrame = 0;
+
+    for (unsigned int i = 0; i < BENCHMARK_TRACE_SAMPLES; i++)
+    {
+        uint64_t timestamp_ms;
+        double value;
+        get_trace_sample(i, &rng, &timestamp_ms, &value);
+
+        // this is what the Sensor sends as plain text payload
+        char text[64];
+        textBytes += snprintf(text, sizeof(text),
+                              "Current Temperature: %.1f°C", value);
+
+        timestamps[numInFrame] = timestamp_ms;
+        values[numInFrame] = value;
+        numInFrame++;
+
+        size_t frameLen;
+        if (!ts_batch_addSample(series, timestamp_ms, value, frame, &frameLen))
+        {
+            continue;
+        }
+
+        // round trip check
+        ts_decoder_t decoder;
+        err = ts_decoder_init(&decoder, frame, frameLen);
+        for (size_t j = 0; (OS_SUCCESS == err) && (j < numInFrame); j++)
+        {
+            uint64_t decodedTimestamp;
+            double decodedValue;
+            err = ts_decoder_next(&decoder, &decodedTimestamp, &decodedValue);
+            if ((OS_SUCCESS == err)
+                && ((decodedTimestamp != timestamps[j])
+                    || (decodedValue != values[j])))
+            {
+                err = OS_ERROR_GENERIC;
+            }
+        }
+        if (OS_SUCCESS != err)
+        {
+            Debug_LOG_ERROR("frame %zu does not decode to the input, code %d",
+                            numFrames, err);
+            return;
+        }
+
+        encodedBytes += frameLen;
+        numFrames++;
+        numInFrame = 0;
+    }
+
+    size_t numSamples = BENCHMARK_TRACE_SAMPLES - numInFrame;
+
+    Debug_LOG_INFO("encoding: %zu samples in %zu frames, %.2f bytes/sample "
+                   "(text %.2f bytes/sample without timestamp)",
+                   numSamples, numFrames,
+                   (double)encodedBytes / numSamples,
+                   (double)textBytes / BENCHMARK_TRACE_SAMPLES);
+}
+
+
+//------------------------------------------------------------------------------
+static void
+benchmark_rules(void)
+{
+    static rules_t rules;
+    static const char config[] =
+        "bench value > 24 || abs(rate) > 0.015 || (value < 22 && delta != 0)";
+
+    OS_Error_t err = rules_init(&rules, config, sizeof(config));
+    if (OS_SUCCESS != err)
+    {
+        Debug_LOG_ERROR("rules_init() failed with %d", err);
+        return;
+    }
+    rules_program_t* program = rules_find(&rules, "bench", strlen("bench"));
+
+    uint32_t rng = 42;
+    size_t numForwarded = 0;
+
+    uint64_t start_ms = glue_tls_mqtt_getTimeMs();
+    for (unsigned int i = 0; i < BENCHMARK_RULE_EVALUATIONS; i++)
+    {
+        uint64_t timestamp_ms;
+        double value;
+        get_trace_sample(i % BENCHMARK_TRACE_SAMPLES, &rng, &timestamp_ms,
+                         &value);
+        if (rules_evaluate(program, timestamp_ms, value))
+        {
+            numForwarded++;
+        }
+    }
+    uint64_t duration_ms = glue_tls_mqtt_getTimeMs() - start_ms;
+
+    // the trace generation is part of the measurement, so this is a lower
+    // bound of what the rules alone achieve
+    Debug_LOG_INFO("rules: %u evaluations of %zu instructions in %" PRIu64
+                   " ms, %" PRIu64 " evaluations/s, %zu forwarded",
+                   BENCHMARK_RULE_EVALUATIONS, program->numOps, duration_ms,
+                   (duration_ms > 0) ?
+                   (BENCHMARK_RULE_EVALUATIONS * 1000ULL / duration_ms) : 0,
+                   numForwarded);
+}
+
+
+//------------------------------------------------------------------------------
+// The first client fills its ring completely in every round, the others send
+// only a few frames. The rings are drained by the scheduler as the
+// CloudConnector does it, the position of the last frame of a quiet client in
+// the drain order shows how long it has to wait behind the noisy one.
+static void
+benchmark_clients_run(
+    size_t numClients)
+{
+    static uint8_t mem[CLIENT_SCHED_MAX_CLIENTS][BENCHMARK_CLIENT_RING_SIZE]
+    __attribute__((aligned(MSG_RING_CACHE_LINE)));
+    static msg_ring_t producers[CLIENT_SCHED_MAX_CLIENTS];
+    static msg_ring_t consumers[CLIENT_SCHED_MAX_CLIENTS];
+    static client_sched_t sched;
+
+    uint8_t frame[BENCHMARK_CLIENT_FRAME_SIZE];
+    memset(frame, 0x5a, sizeof(frame));
+    memset(mem, 0, sizeof(mem));
+
+    client_sched_init(&sched);
+    for (size_t i = 0; i < numClients; i++)
+    {
+        msg_ring_init(&producers[i], mem[i], sizeof(mem[i]));
+        msg_ring_init(&consumers[i], mem[i], sizeof(mem[i]));
+        client_sched_addClient(&sched, &consumers[i], 1);
+    }
+
+    uint64_t numFrames = 0;
+    uint64_t sumQuietWait = 0;
+    uint32_t checksum = 0;
+
+    uint64_t start_ms = glue_tls_mqtt_getTimeMs();
+    for (unsigned int round = 0; round < BENCHMARK_CLIENT_ROUNDS; round++)
+    {
+        while (OS_SUCCESS == msg_ring_enqueue(&producers[0], frame,
+                                              sizeof(frame), NULL))
+        {
+        }
+        for (size_t i = 1; i < numClients; i++)
+        {
+            for (unsigned int j = 0; j < BENCHMARK_CLIENT_QUIET; j++)
+            {
+                msg_ring_enqueue(&producers[i], frame, sizeof(frame), NULL);
+            }
+        }
+
+        size_t position = 0;
+        size_t lastQuiet = 0;
+        size_t client;
+        const void* buf;
+        size_t len;
+        while (OS_SUCCESS == client_sched_next(&sched, &client, &buf, &len))
+        {
+            checksum += ((const uint8_t*)buf)[len - 1];
+            msg_ring_release(client_sched_getRing(&sched, client));
+            position++;
+            if (client > 0)
+            {
+                lastQuiet = position;
+            }
+        }
+        numFrames += position;
+        sumQuietWait += lastQuiet;
+    }
+    uint64_t duration_ms = glue_tls_mqtt_getTimeMs() - start_ms;
+
+    Debug_LOG_INFO("clients: %zu client(s), %" PRIu64 " frames in %" PRIu64
+                   " ms, %" PRIu64 " frames/s, quiet clients done after %"
+                   PRIu64 " frames per round (checksum %u)",
+                   numClients, numFrames, duration_ms,
+                   (duration_ms > 0) ? (numFrames * 1000 / duration_ms) : 0,
+                   sumQuietWait / BENCHMARK_CLIENT_ROUNDS, checksum);
+}
+
+
+//------------------------------------------------------------------------------
+static void
+benchmark_clients(void)
+{
+    for (size_t n = 1; n <= CLIENT_SCHED_MAX_CLIENTS; n++)
+    {
+        benchmark_clients_run(n);
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// Compare the decoding of a reading on the local hop, MQTT PUBLISH packets
+// with the topic copied out as it was done before and binary records.
+static void
+benchmark_records(void)
+{
+    static const char topic[] = "TempSensor_01/temperature";
+    static const char payload[] = "Current Temperature: 23C";
+    static unsigned char packet[128];
+    static uint8_t frame[sizeof(sensor_record_t) + sizeof(payload)];
+    char topicBuf[64];
+
+    MQTTString mqttTopic = MQTTString_initializer;
+    mqttTopic.cstring = (char*)topic;
+    int packetLen = MQTTSerialize_publish(packet, sizeof(packet), 0, 1, 0, 1,
+                                          mqttTopic, (unsigned char*)payload,
+                                          strlen(payload));
+
+    sensor_record_t record =
+    {
+        .type          = SENSOR_RECORD_TYPE_TEXT,
+        .value.dataLen = strlen(payload),
+    };
+    size_t frameLen;
+    if ((packetLen <= 0)
+        || (OS_SUCCESS != sensor_record_write(frame, sizeof(frame), &record,
+                                              payload, &frameLen)))
+    {
+        Debug_LOG_ERROR("benchmark setup failed");
+        return;
+    }
+
+    size_t checksum = 0;
+
+    uint64_t start_ms = glue_tls_mqtt_getTimeMs();
+    for (unsigned int i = 0; i < BENCHMARK_RECORD_READS; i++)
+    {
+        unsigned char dup, retained;
+        unsigned short id;
+        int qos, len;
+        unsigned char* data;
+        MQTTString t;
+        if (1 == MQTTDeserialize_publish(&dup, &qos, &retained, &id, &t,
+                                         &data, &len, packet, packetLen))
+        {
+            size_t topicLen = t.lenstring.len;
+            if (topicLen < sizeof(topicBuf))
+            {
+                memcpy(topicBuf, t.lenstring.data, topicLen);
+                topicBuf[topicLen] = '\0';
+                checksum += strlen(topicBuf) + len;
+            }
+        }
+    }
+    uint64_t mqtt_ms = glue_tls_mqtt_getTimeMs() - start_ms;
+
+    start_ms = glue_tls_mqtt_getTimeMs();
+    for (unsigned int i = 0; i < BENCHMARK_RECORD_READS; i++)
+    {
+        sensor_record_t r;
+        const void* data;
+        if (OS_SUCCESS == sensor_record_read(frame, frameLen, &r, &data))
+        {
+            checksum += r.topicId + r.value.dataLen;
+        }
+    }
+    uint64_t record_ms = glue_tls_mqtt_getTimeMs() - start_ms;
+
+    Debug_LOG_INFO("records: %u decodes, MQTT %" PRIu64 " ms (%d bytes), "
+                   "record %" PRIu64 " ms (%zu bytes) (checksum %zu)",
+                   BENCHMARK_RECORD_READS, mqtt_ms, packetLen, record_ms,
+                   frameLen, checksum);
+}
+
+
+//------------------------------------------------------------------------------
+// Sensor to CloudConnector throughput for different batch sizes. The records
+// take the way through the message ring, the publish on the WAN is not part
+// of it.
+static void
+benchmark_batches(void)
+{
+    static uint8_t mem[BENCHMARK_CLIENT_RING_SIZE]
+    __attribute__((aligned(MSG_RING_CACHE_LINE)));
+    static sensor_record_sample_t samples[64];
+    static uint8_t frame[sizeof(sensor_record_t) + sizeof(samples)];
+    static const size_t batchSizes[] = { 1, 8, 32, 64 };
+
+    for (size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++)
+    {
+        const size_t batchSize = batchSizes[b];
+
+        msg_ring_t producer, consumer;
+        memset(mem, 0, sizeof(mem));
+        msg_ring_init(&producer, mem, sizeof(mem));
+        msg_ring_init(&consumer, mem, sizeof(mem));
+
+        uint32_t seq = 0;
+        size_t numReceived = 0;
+        size_t numBytes = 0;
+        double sum = 0;
+
+        uint64_t start_ms = glue_tls_mqtt_getTimeMs();
+        while (seq < BENCHMARK_BATCH_SAMPLES)
+        {
+            for (size_t i = 0; i < batchSize; i++)
+            {
+                samples[i].timestamp_ms = start_ms + seq + i;
+                samples[i].value = (double)(seq + i);
+            }
+
+            sensor_record_t record =
+            {
+                .type          = (1 == batchSize) ? SENSOR_RECORD_TYPE_F64
+                                 : SENSOR_RECORD_TYPE_BATCH,
+                .seq           = seq,
+                .timestamp_ms  = samples[0].timestamp_ms,
+            };
+            if (1 == batchSize)
+            {
+                record.value.f64 = samples[0].value;
+            }
+            else
+            {
+                record.value.dataLen = batchSize * sizeof(samples[0]);
+            }
+
+            size_t len;
+            sensor_record_write(frame, sizeof(frame), &record, samples, &len);
+            OS_Error_t err = msg_ring_enqueue(&producer, frame, len, NULL);
+            if (OS_SUCCESS == err)
+            {
+                seq += batchSize;
+                numBytes += len;
+            }
+
+            // the consumer runs whenever the ring is full or the last batch
+            // has been sent
+            if ((OS_SUCCESS == err) && (seq < BENCHMARK_BATCH_SAMPLES))
+            {
+                continue;
+            }
+
+            const void* buf;
+            size_t bufLen;
+            while (OS_SUCCESS == msg_ring_peek(&consumer, &buf, &bufLen, NULL))
+            {
+                sensor_record_t r;
+                const void* data;
+                if (OS_SUCCESS == sensor_record_read(buf, bufLen, &r, &data))
+                {
+                    numReceived += sensor_record_getNumSamples(&r);
+                    sum += (SENSOR_RECORD_TYPE_BATCH == r.type) ?
+                           ((const sensor_record_sample_t*)data)[0].value
+                           : r.value.f64;
+                }
+                msg_ring_release(&consumer);
+            }
+        }
+        uint64_t duration_ms = glue_tls_mqtt_getTimeMs() - start_ms;
+
+        Debug_LOG_INFO("batches: %zu samples/message, %zu samples in %" PRIu64
+                       " ms, %" PRIu64 " samples/s, %.1f bytes/sample "
+                       "(checksum %.0f)",
+                       batchSize, numReceived, duration_ms,
+                       (duration_ms > 0) ?
+                       (numReceived * 1000ULL / duration_ms) : 0,
+                       (double)numBytes / numReceived, sum);
+    }
+}
+
+
+//==============================================================================
+// public functions
+//==============================================================================
+
+//------------------------------------------------------------------------------
+void
+benchmark_CloudConnector_run(void)
+{
+    Debug_LOG_INFO("Running CloudConnector benchmarks...");
+
+    benchmark_encoding();
+    benchmark_rules();
+    benchmark_clients();
+    benchmark_records();
+    benchmark_batches();
+
+    Debug_LOG_INFO("CloudConnector benchmarks done");
+}
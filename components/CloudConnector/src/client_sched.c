@@ -0,0 +1,133 @@
+/*
+ * Weighted round-robin scheduling of the message rings of the Sensor clients
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "client_sched.h"
+
+#include "lib_debug/Debug.h"
+
+//------------------------------------------------------------------------------
+static void
+advance(
+    client_sched_t* self)
+{
+    self->current = (self->current + 1) % self->numClients;
+    self->credit  = self->clients[self->current].weight;
+}
+
+//------------------------------------------------------------------------------
+void
+client_sched_init(
+    client_sched_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    self->numClients = 0;
+    self->current    = 0;
+    self->credit     = 0;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+client_sched_addClient(
+    client_sched_t* self,
+    msg_ring_t*     ring,
+    unsigned int    weight)
+{
+    Debug_ASSERT_SELF(self);
+
+    if ((NULL == ring) || (0 == weight))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if (self->numClients >= CLIENT_SCHED_MAX_CLIENTS)
+    {
+        return OS_ERROR_INSUFFICIENT_SPACE;
+    }
+
+    client_sched_client_t* c = &self->clients[self->numClients];
+    c->ring       = ring;
+    c->weight     = weight;
+    c->isDisabled = false;
+
+    // the first client starts the first round
+    if (0 == self->numClients)
+    {
+        self->credit = weight;
+    }
+    self->numClients++;
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+client_sched_next(
+    client_sched_t* self,
+    size_t*         client,
+    const void**    frame,
+    size_t*         frameLen)
+{
+    Debug_ASSERT_SELF(self);
+
+    if (0 == self->numClients)
+    {
+        return OS_ERROR_NO_DATA;
+    }
+
+    // each client is asked once, the current one may have credit left
+    for (size_t i = 0; i <= self->numClients; i++)
+    {
+        if (0 == self->credit)
+        {
+            advance(self);
+        }
+
+        client_sched_client_t* c = &self->clients[self->current];
+        if (c->isDisabled)
+        {
+            self->credit = 0;
+            continue;
+        }
+
+        OS_Error_t err = msg_ring_peek(c->ring, frame, frameLen, NULL);
+        if (OS_SUCCESS == err)
+        {
+            self->credit--;
+            *client = self->current;
+            return OS_SUCCESS;
+        }
+
+        // an empty ring passes its turn on
+        self->credit = 0;
+
+        if (OS_ERROR_NO_DATA != err)
+        {
+            // the producer has corrupted the ring, it can't be trusted anymore
+            c->isDisabled = true;
+            *client = self->current;
+            return err;
+        }
+    }
+
+    return OS_ERROR_NO_DATA;
+}
+
+//------------------------------------------------------------------------------
+msg_ring_t*
+client_sched_getRing(
+    client_sched_t* self,
+    size_t          client)
+{
+    Debug_ASSERT_SELF(self);
+    Debug_ASSERT(client < self->numClients);
+
+    return self->clients[client].ring;
+}
@@ -0,0 +1,66 @@
+/*
+ * Weighted round-robin scheduling of the message rings of the Sensor clients
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include "msg_ring.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CLIENT_SCHED_MAX_CLIENTS    4
+
+typedef struct
+{
+    msg_ring_t*     ring;
+    unsigned int    weight;
+    bool            isDisabled;
+} client_sched_client_t;
+
+typedef struct
+{
+    client_sched_client_t   clients[CLIENT_SCHED_MAX_CLIENTS];
+    size_t                  numClients;
+
+    // client that is served and the frames it may still get in this round
+    size_t                  current;
+    unsigned int            credit;
+} client_sched_t;
+
+
+void
+client_sched_init(
+    client_sched_t* self);
+
+// Add a client, it gets up to weight frames per round.
+OS_Error_t
+client_sched_addClient(
+    client_sched_t* self,
+    msg_ring_t*     ring,
+    unsigned int    weight);
+
+// Get the oldest frame of the client whose turn it is, clients with an empty
+// ring are skipped. The frame must be released in the ring of the returned
+// client before this is called again. Returns OS_ERROR_NO_DATA if all rings
+// are empty. If a ring is corrupted, its error is returned together with the
+// client once, and the client is not served any longer.
+OS_Error_t
+client_sched_next(
+    client_sched_t* self,
+    size_t*         client,
+    const void**    frame,
+    size_t*         frameLen);
+
+msg_ring_t*
+client_sched_getRing(
+    client_sched_t* self,
+    size_t          client);
@@ -206,6 +206,24 @@ connectSocket(
     return ret;
 }
 
+// the init is repeated when the connection is re-established, so nothing must
+// be left allocated on failure
+static void
+freeTls(void)
+{
+    OS_Error_t ret = OS_Tls_free(tlsContext);
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("OS_Tls_free() failed with: %d", ret);
+    }
+
+    ret = OS_Crypto_free(hCrypto);
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("OS_Crypto_free() failed with: %d", ret);
+    }
+}
+
 //------------------------------------------------------------------------------
 OS_Error_t
 glue_tls_init(
@@ -231,6 +249,7 @@ glue_tls_init(
     if (ret != OS_SUCCESS)
     {
         Debug_LOG_ERROR("OS_Tls_init() failed with: %d", ret);
+        OS_Crypto_free(hCrypto);
         return ret;
     }
 
@@ -239,6 +258,7 @@ glue_tls_init(
     if (OS_SUCCESS != ret)
     {
         Debug_LOG_ERROR("waitForNetworkStackInit() failed with: %d", ret);
+        freeTls();
         return ret;
     }
 
@@ -253,6 +273,7 @@ glue_tls_init(
     if (OS_SUCCESS != ret)
     {
         Debug_LOG_ERROR("connectSocket() failed with err %d", ret);
+        freeTls();
         return ret;
     }
 
@@ -275,6 +296,19 @@ glue_tls_handshake(void)
     return OS_SUCCESS;
 }
 
+//------------------------------------------------------------------------------
+void
+glue_tls_close(void)
+{
+    OS_Error_t ret = OS_Socket_close(socketHandle);
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("OS_Socket_close() failed with: %d", ret);
+    }
+
+    freeTls();
+}
+
 //------------------------------------------------------------------------------
 uint64_t
 glue_tls_mqtt_getTimeMs(void)
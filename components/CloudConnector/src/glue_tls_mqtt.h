@@ -38,6 +38,11 @@ glue_tls_init(const char* ipAddress,
 OS_Error_t
 glue_tls_handshake(void);
 
+// Close the connection and free the TLS session, glue_tls_init() must be
+// called again before the next handshake.
+void
+glue_tls_close(void);
+
 uint64_t
 glue_tls_mqtt_getTimeMs(void);
 
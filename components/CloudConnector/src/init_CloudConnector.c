@@ -13,6 +13,7 @@
 
 #include "lib_debug/Debug.h"
 #include "OS_ConfigService.h"
+#include "helper_func.h"
 
 /* Instance variables --------------------------------------------------------*/
 OS_ConfigServiceHandle_t serverLibWithMemBackend;
@@ -33,5 +34,9 @@ init_config_handle(OS_ConfigServiceHandle_t* configHandle)
         return err;
     }
 
+    // parameters are read from the snapshot of the ConfigServer, if there is one
+    helper_func_attachConfigSnapshot(
+        (OS_Dataport_t) OS_DATAPORT_ASSIGN(configSnapshot_port));
+
     return OS_SUCCESS;
 }
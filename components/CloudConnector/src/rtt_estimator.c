@@ -0,0 +1,121 @@
+/*
+ * Round trip time estimation and retransmission timeout as in RFC 6298
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "rtt_estimator.h"
+
+#include "lib_debug/Debug.h"
+
+// the clock granularity G of RFC 6298, the TimeServer has a millisecond tick
+#define RTT_CLOCK_GRANULARITY_MS    1
+
+//------------------------------------------------------------------------------
+static uint32_t
+clamp(
+    const rtt_estimator_t*  self,
+    uint64_t                value_ms)
+{
+    if (value_ms < self->min_ms)
+    {
+        return self->min_ms;
+    }
+    if (value_ms > self->max_ms)
+    {
+        return self->max_ms;
+    }
+    return (uint32_t)value_ms;
+}
+
+//------------------------------------------------------------------------------
+void
+rtt_estimator_init(
+    rtt_estimator_t*    self,
+    uint32_t            initial_ms,
+    uint32_t            min_ms,
+    uint32_t            max_ms)
+{
+    Debug_ASSERT_SELF(self);
+    Debug_ASSERT(min_ms <= max_ms);
+
+    self->srtt_x8   = 0;
+    self->rttvar_x8 = 0;
+    self->min_ms    = min_ms;
+    self->max_ms    = max_ms;
+    self->rto_ms    = clamp(self, initial_ms);
+    self->hasSample = false;
+}
+
+//------------------------------------------------------------------------------
+void
+rtt_estimator_addSample(
+    rtt_estimator_t*    self,
+    uint32_t            rtt_ms)
+{
+    Debug_ASSERT_SELF(self);
+
+    uint32_t rtt_x8 = rtt_ms * 8;
+
+    if (!self->hasSample)
+    {
+        // SRTT = R, RTTVAR = R/2
+        self->srtt_x8   = rtt_x8;
+        self->rttvar_x8 = rtt_x8 / 2;
+        self->hasSample = true;
+    }
+    else
+    {
+        // RTTVAR = 3/4 * RTTVAR + 1/4 * |SRTT - R|
+        // SRTT   = 7/8 * SRTT   + 1/8 * R
+        uint32_t err_x8 = (self->srtt_x8 > rtt_x8) ?
+                          (self->srtt_x8 - rtt_x8) : (rtt_x8 - self->srtt_x8);
+        self->rttvar_x8 = self->rttvar_x8 - (self->rttvar_x8 / 4) + (err_x8 / 4);
+        self->srtt_x8   = self->srtt_x8 - (self->srtt_x8 / 8) + (rtt_x8 / 8);
+    }
+
+    // RTO = SRTT + max(G, 4 * RTTVAR), rounded up
+    uint64_t var_ms = ((uint64_t)self->rttvar_x8 * 4 + 7) / 8;
+    if (var_ms < RTT_CLOCK_GRANULARITY_MS)
+    {
+        var_ms = RTT_CLOCK_GRANULARITY_MS;
+    }
+    self->rto_ms = clamp(self, ((self->srtt_x8 + 7) / 8) + var_ms);
+
+    Debug_LOG_DEBUG("RTT sample %u ms, SRTT %u ms, RTO %u ms",
+                    rtt_ms, rtt_estimator_getSmoothedRtt(self), self->rto_ms);
+}
+
+//------------------------------------------------------------------------------
+void
+rtt_estimator_backoff(
+    rtt_estimator_t*    self)
+{
+    Debug_ASSERT_SELF(self);
+
+    self->rto_ms = clamp(self, (uint64_t)self->rto_ms * 2);
+}
+
+//------------------------------------------------------------------------------
+uint32_t
+rtt_estimator_getTimeout(
+    const rtt_estimator_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    return self->rto_ms;
+}
+
+//------------------------------------------------------------------------------
+uint32_t
+rtt_estimator_getSmoothedRtt(
+    const rtt_estimator_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    return (self->srtt_x8 + 4) / 8;
+}
@@ -0,0 +1,54 @@
+/*
+ * Round trip time estimation and retransmission timeout as in RFC 6298
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    // smoothed RTT and its variance, both scaled by 8 to keep the fractional
+    // part with integer arithmetic
+    uint32_t    srtt_x8;
+    uint32_t    rttvar_x8;
+    uint32_t    rto_ms;
+
+    uint32_t    min_ms;
+    uint32_t    max_ms;
+    bool        hasSample;
+} rtt_estimator_t;
+
+void
+rtt_estimator_init(
+    rtt_estimator_t*    self,
+    uint32_t            initial_ms,
+    uint32_t            min_ms,
+    uint32_t            max_ms);
+
+// Add a measured round trip. Samples must only be taken from exchanges that
+// did not time out (Karn's algorithm).
+void
+rtt_estimator_addSample(
+    rtt_estimator_t*    self,
+    uint32_t            rtt_ms);
+
+// Double the timeout after a timeout.
+void
+rtt_estimator_backoff(
+    rtt_estimator_t*    self);
+
+uint32_t
+rtt_estimator_getTimeout(
+    const rtt_estimator_t* self);
+
+uint32_t
+rtt_estimator_getSmoothedRtt(
+    const rtt_estimator_t* self);
@@ -0,0 +1,454 @@
+/*
+ * Filter rules for the messages forwarded by the CloudConnector
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "rules.h"
+#include "cfg_text.h"
+
+#include "lib_debug/Debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum
+{
+    RULES_OP_VALUE,
+    RULES_OP_DELTA,
+    RULES_OP_RATE,
+    RULES_OP_CONST,
+    RULES_OP_ABS,
+    RULES_OP_LT,
+    RULES_OP_LE,
+    RULES_OP_GT,
+    RULES_OP_GE,
+    RULES_OP_EQ,
+    RULES_OP_NE,
+    RULES_OP_AND,
+    RULES_OP_OR,
+    RULES_OP_NOT
+} rules_opcode_t;
+
+typedef struct
+{
+    const char*         pos;
+    rules_program_t*    program;
+    size_t              depth;
+    size_t              maxDepth;
+    OS_Error_t          err;
+} compiler_t;
+
+
+//==============================================================================
+// compiler
+//==============================================================================
+
+//------------------------------------------------------------------------------
+static void
+skip_spaces(
+    compiler_t* c)
+{
+    while ((*c->pos == ' ') || (*c->pos == '\t') || (*c->pos == '\r'))
+    {
+        c->pos++;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Consume the token if it comes next.
+static bool
+accept(
+    compiler_t* c,
+    const char* token)
+{
+    skip_spaces(c);
+
+    size_t len = strlen(token);
+    if (0 != strncmp(c->pos, token, len))
+    {
+        return false;
+    }
+
+    c->pos += len;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static void
+fail(
+    compiler_t* c,
+    const char* msg)
+{
+    if (OS_SUCCESS == c->err)
+    {
+        Debug_LOG_ERROR("rule for '%s': %s at '%s'",
+                        c->program->topic, msg, c->pos);
+        c->err = OS_ERROR_INVALID_PARAMETER;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Emit an instruction and track the stack depth it results in, so the
+// evaluation does not need any bounds checks.
+static void
+emit(
+    compiler_t* c,
+    uint8_t     opcode,
+    uint8_t     arg,
+    int         stackChange)
+{
+    rules_program_t* p = c->program;
+
+    if (p->numOps >= RULES_MAX_OPS)
+    {
+        fail(c, "too many instructions");
+        return;
+    }
+
+    c->depth += stackChange;
+    if (c->depth > RULES_STACK_SIZE)
+    {
+        fail(c, "nested too deep");
+        return;
+    }
+    if (c->depth > c->maxDepth)
+    {
+        c->maxDepth = c->depth;
+    }
+
+    p->code[p->numOps].opcode = opcode;
+    p->code[p->numOps].arg = arg;
+    p->numOps++;
+}
+
+static void compile_condition(compiler_t* c);
+
+//------------------------------------------------------------------------------
+static void
+compile_operand(
+    compiler_t* c)
+{
+    if (accept(c, "value"))
+    {
+        emit(c, RULES_OP_VALUE, 0, 1);
+    }
+    else if (accept(c, "delta"))
+    {
+        emit(c, RULES_OP_DELTA, 0, 1);
+    }
+    else if (accept(c, "rate"))
+    {
+        emit(c, RULES_OP_RATE, 0, 1);
+    }
+    else if (accept(c, "abs"))
+    {
+        if (!accept(c, "("))
+        {
+            fail(c, "'(' expected");
+            return;
+        }
+        compile_operand(c);
+        emit(c, RULES_OP_ABS, 0, 0);
+        if (!accept(c, ")"))
+        {
+            fail(c, "')' expected");
+        }
+    }
+    else
+    {
+        char* end;
+        double number = strtod(c->pos, &end);
+        if (end == c->pos)
+        {
+            fail(c, "operand expected");
+            return;
+        }
+        c->pos = end;
+
+        rules_program_t* p = c->program;
+        if (p->numConsts >= RULES_MAX_CONSTS)
+        {
+            fail(c, "too many constants");
+            return;
+        }
+        p->consts[p->numConsts] = number;
+        emit(c, RULES_OP_CONST, (uint8_t)p->numConsts, 1);
+        p->numConsts++;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void
+compile_factor(
+    compiler_t* c)
+{
+    // the two character operators must be checked first
+    static const struct
+    {
+        const char*     token;
+        rules_opcode_t  opcode;
+    } compares[] =
+    {
+        { "<=", RULES_OP_LE },
+        { ">=", RULES_OP_GE },
+        { "==", RULES_OP_EQ },
+        { "!=", RULES_OP_NE },
+        { "<",  RULES_OP_LT },
+        { ">",  RULES_OP_GT },
+    };
+
+    if (accept(c, "!"))
+    {
+        compile_factor(c);
+        emit(c, RULES_OP_NOT, 0, 0);
+        return;
+    }
+
+    if (accept(c, "("))
+    {
+        compile_condition(c);
+        if (!accept(c, ")"))
+        {
+            fail(c, "')' expected");
+        }
+        return;
+    }
+
+    compile_operand(c);
+
+    for (size_t i = 0; i < sizeof(compares) / sizeof(compares[0]); i++)
+    {
+        if (accept(c, compares[i].token))
+        {
+            compile_operand(c);
+            emit(c, compares[i].opcode, 0, -1);
+            return;
+        }
+    }
+
+    fail(c, "comparison expected");
+}
+
+//------------------------------------------------------------------------------
+static void
+compile_term(
+    compiler_t* c)
+{
+    compile_factor(c);
+    while ((OS_SUCCESS == c->err) && accept(c, "&&"))
+    {
+        compile_factor(c);
+        emit(c, RULES_OP_AND, 0, -1);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void
+compile_condition(
+    compiler_t* c)
+{
+    compile_term(c);
+    while ((OS_SUCCESS == c->err) && accept(c, "||"))
+    {
+        compile_term(c);
+        emit(c, RULES_OP_OR, 0, -1);
+    }
+}
+
+//------------------------------------------------------------------------------
+static OS_Error_t
+compile_line(
+    rules_program_t*    program,
+    const char*         line)
+{
+    memset(program, 0, sizeof(*program));
+
+    // the topic is the first word of the line
+    size_t len = strcspn(line, " \t");
+    if (len >= sizeof(program->topic))
+    {
+        Debug_LOG_ERROR("topic too long in rule '%s'", line);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+    memcpy(program->topic, line, len);
+
+    compiler_t c =
+    {
+        .pos        = line + len,
+        .program    = program,
+        .err        = OS_SUCCESS,
+    };
+
+    compile_condition(&c);
+    skip_spaces(&c);
+    if (*c.pos != '\0')
+    {
+        fail(&c, "unexpected input");
+    }
+
+    if (OS_SUCCESS == c.err)
+    {
+        Debug_LOG_INFO("rule for '%s' compiled into %zu instructions",
+                       program->topic, program->numOps);
+    }
+
+    return c.err;
+}
+
+
+//==============================================================================
+// public functions
+//==============================================================================
+
+//------------------------------------------------------------------------------
+OS_Error_t
+rules_init(
+    rules_t*        self,
+    const char*     config,
+    size_t          configLen)
+{
+    Debug_ASSERT_SELF(self);
+    Debug_ASSERT(NULL != config);
+
+    memset(self, 0, sizeof(*self));
+
+    size_t pos = 0;
+    char line[RULES_MAX_TOPIC_LEN + 128];
+    while (cfg_text_nextLine(config, configLen, &pos, line, sizeof(line)))
+    {
+        if (self->numPrograms >= RULES_MAX_TOPICS)
+        {
+            Debug_LOG_ERROR("too many rules, max is %u", RULES_MAX_TOPICS);
+            return OS_ERROR_OUT_OF_BOUNDS;
+        }
+
+        OS_Error_t err = compile_line(&self->programs[self->numPrograms], line);
+        if (OS_SUCCESS != err)
+        {
+            return err;
+        }
+        self->numPrograms++;
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+rules_program_t*
+rules_find(
+    rules_t*        self,
+    const char*     topic,
+    size_t          topicLen)
+{
+    Debug_ASSERT_SELF(self);
+
+    for (size_t i = 0; i < self->numPrograms; i++)
+    {
+        const char* name = self->programs[i].topic;
+        if ((0 == strncmp(name, topic, topicLen)) && (name[topicLen] == '\0'))
+        {
+            return &self->programs[i];
+        }
+    }
+
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+bool
+rules_evaluate(
+    rules_program_t*    program,
+    uint64_t            timestamp_ms,
+    double              value)
+{
+    Debug_ASSERT(NULL != program);
+
+    double delta = 0;
+    double rate = 0;
+    if (program->hasPrev)
+    {
+        delta = value - program->prevValue;
+        if (timestamp_ms > program->prevTimestamp_ms)
+        {
+            rate = delta * 1000 / (timestamp_ms - program->prevTimestamp_ms);
+        }
+    }
+
+    program->hasPrev = true;
+    program->prevValue = value;
+    program->prevTimestamp_ms = timestamp_ms;
+
+    // the compiler guarantees that the stack does not overflow
+    double stack[RULES_STACK_SIZE];
+    size_t sp = 0;
+
+    for (size_t i = 0; i < program->numOps; i++)
+    {
+        const rules_op_t* op = &program->code[i];
+        switch (op->opcode)
+        {
+        case RULES_OP_VALUE:
+            stack[sp++] = value;
+            break;
+        case RULES_OP_DELTA:
+            stack[sp++] = delta;
+            break;
+        case RULES_OP_RATE:
+            stack[sp++] = rate;
+            break;
+        case RULES_OP_CONST:
+            stack[sp++] = program->consts[op->arg];
+            break;
+        case RULES_OP_ABS:
+            stack[sp - 1] = (stack[sp - 1] < 0) ? -stack[sp - 1] : stack[sp - 1];
+            break;
+        case RULES_OP_LT:
+            sp--;
+            stack[sp - 1] = (stack[sp - 1] < stack[sp]);
+            break;
+        case RULES_OP_LE:
+            sp--;
+            stack[sp - 1] = (stack[sp - 1] <= stack[sp]);
+            break;
+        case RULES_OP_GT:
+            sp--;
+            stack[sp - 1] = (stack[sp - 1] > stack[sp]);
+            break;
+        case RULES_OP_GE:
+            sp--;
+            stack[sp - 1] = (stack[sp - 1] >= stack[sp]);
+            break;
+        case RULES_OP_EQ:
+            sp--;
+            stack[sp - 1] = (stack[sp - 1] == stack[sp]);
+            break;
+        case RULES_OP_NE:
+            sp--;
+            stack[sp - 1] = (stack[sp - 1] != stack[sp]);
+            break;
+        case RULES_OP_AND:
+            sp--;
+            stack[sp - 1] = (stack[sp - 1] != 0) && (stack[sp] != 0);
+            break;
+        case RULES_OP_OR:
+            sp--;
+            stack[sp - 1] = (stack[sp - 1] != 0) || (stack[sp] != 0);
+            break;
+        case RULES_OP_NOT:
+            stack[sp - 1] = (stack[sp - 1] == 0);
+            break;
+        default:
+            Debug_ASSERT(false);
+            return true;
+        }
+    }
+
+    Debug_ASSERT(1 == sp);
+
+    return (stack[0] != 0);
+}
@@ -0,0 +1,93 @@
+/*
+ * Filter rules for the messages forwarded by the CloudConnector
+ *
+ * A rule is a condition per topic, a message is forwarded only if it holds.
+ * The rules are given as text, one per line:
+ *
+ *   <topic> <condition>
+ *
+ * with the condition being
+ *
+ *   condition := term { "||" term }
+ *   term      := factor { "&&" factor }
+ *   factor    := "!" factor | "(" condition ")" | operand compare operand
+ *   compare   := "<" | "<=" | ">" | ">=" | "==" | "!="
+ *   operand   := "value" | "delta" | "rate" | number | "abs" "(" operand ")"
+ *
+ * where "delta" is the change since the previous message of the topic and
+ * "rate" is this change per second. Example:
+ *
+ *   devices/tempsensor/messages/events/ value > 30 || abs(rate) > 0.5
+ *
+ * Rules are compiled into a bytecode without jumps, so evaluating a rule costs
+ * at most RULES_MAX_OPS instructions.
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RULES_MAX_TOPICS        4
+#define RULES_MAX_TOPIC_LEN     128
+#define RULES_MAX_OPS           32
+#define RULES_MAX_CONSTS        8
+#define RULES_STACK_SIZE        8
+
+typedef struct
+{
+    uint8_t     opcode;
+    uint8_t     arg;
+} rules_op_t;
+
+typedef struct
+{
+    char        topic[RULES_MAX_TOPIC_LEN];
+
+    rules_op_t  code[RULES_MAX_OPS];
+    size_t      numOps;
+    double      consts[RULES_MAX_CONSTS];
+    size_t      numConsts;
+
+    bool        hasPrev;
+    uint64_t    prevTimestamp_ms;
+    double      prevValue;
+} rules_program_t;
+
+typedef struct
+{
+    rules_program_t programs[RULES_MAX_TOPICS];
+    size_t          numPrograms;
+} rules_t;
+
+// Compile the rules from the text configuration. Empty lines and lines starting
+// with '#' are ignored.
+OS_Error_t
+rules_init(
+    rules_t*        self,
+    const char*     config,
+    size_t          configLen);
+
+// The topic does not have to be NULL-terminated.
+rules_program_t*
+rules_find(
+    rules_t*        self,
+    const char*     topic,
+    size_t          topicLen);
+
+// Returns true if the message shall be forwarded. The value becomes the
+// previous value of the topic in any case.
+bool
+rules_evaluate(
+    rules_program_t*    program,
+    uint64_t            timestamp_ms,
+    double              value);
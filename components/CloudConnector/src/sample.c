@@ -0,0 +1,75 @@
+/*
+ * Numeric samples carried in sensor payloads
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "sample.h"
+
+#include "lib_debug/Debug.h"
+
+#include <stdbool.h>
+
+//------------------------------------------------------------------------------
+static bool
+is_digit(
+    char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+sample_parsePayload(
+    const void* payload,
+    size_t      payloadLen,
+    double*     value)
+{
+    Debug_ASSERT(NULL != payload);
+    Debug_ASSERT(NULL != value);
+
+    const char* str = (const char*)payload;
+    size_t pos = 0;
+
+    // skip everything up to the first digit, an optional sign directly in
+    // front of it belongs to the number
+    while ((pos < payloadLen) && !is_digit(str[pos]))
+    {
+        pos++;
+    }
+    if (pos >= payloadLen)
+    {
+        return OS_ERROR_NOT_FOUND;
+    }
+
+    bool isNegative = (pos > 0) && (str[pos - 1] == '-');
+
+    // We do not use strtod() here, as the payload is not NULL-terminated and
+    // is located in a buffer we must not write to.
+    double result = 0;
+    while ((pos < payloadLen) && is_digit(str[pos]))
+    {
+        result = (result * 10) + (str[pos] - '0');
+        pos++;
+    }
+
+    if ((pos + 1 < payloadLen) && (str[pos] == '.') && is_digit(str[pos + 1]))
+    {
+        double scale = 0.1;
+        pos++;
+        while ((pos < payloadLen) && is_digit(str[pos]))
+        {
+            result += (str[pos] - '0') * scale;
+            scale /= 10;
+            pos++;
+        }
+    }
+
+    *value = isNegative ? -result : result;
+
+    return OS_SUCCESS;
+}
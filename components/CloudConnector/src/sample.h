@@ -0,0 +1,30 @@
+/*
+ * Numeric samples carried in sensor payloads
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint64_t    timestamp_ms;
+    double      value;
+} sample_t;
+
+// Extract the first decimal number from a text payload, e.g. 23 from
+// "Current Temperature: 23°C". The payload does not have to be terminated.
+OS_Error_t
+sample_parsePayload(
+    const void* payload,
+    size_t      payloadLen,
+    double*     value);
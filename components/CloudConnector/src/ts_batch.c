@@ -0,0 +1,156 @@
+/*
+ * Batching of numeric samples per topic into encoded frames
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "ts_batch.h"
+#include "cfg_text.h"
+
+#include "lib_debug/Debug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+static OS_Error_t
+parse_line(
+    ts_batch_series_t*  series,
+    const char*         line)
+{
+    char type[16];
+    unsigned int samplesPerFrame = 0;
+
+    int cnt = sscanf(line, "%127s %15s %u",
+                     series->topic, type, &samplesPerFrame);
+    if ((cnt < 3) || (0 != strcmp(type, "gorilla")))
+    {
+        Debug_LOG_ERROR("invalid encoding config line: '%s'", line);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if ((0 == samplesPerFrame) || (samplesPerFrame > TS_CODEC_MAX_SAMPLES))
+    {
+        Debug_LOG_ERROR("invalid number of samples per frame: %u",
+                        samplesPerFrame);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    series->samplesPerFrame = samplesPerFrame;
+
+    Debug_LOG_INFO("encoding '%s' in frames of %u samples",
+                   series->topic, samplesPerFrame);
+
+    return ts_encoder_init(&series->encoder,
+                           series->frame,
+                           sizeof(series->frame));
+}
+
+//------------------------------------------------------------------------------
+static void
+flush_frame(
+    ts_batch_series_t*  series,
+    void*               frame,
+    size_t*             frameLen)
+{
+    *frameLen = ts_encoder_getSize(&series->encoder);
+    memcpy(frame, series->frame, *frameLen);
+
+    ts_encoder_init(&series->encoder, series->frame, sizeof(series->frame));
+}
+
+
+//==============================================================================
+// public functions
+//==============================================================================
+
+//------------------------------------------------------------------------------
+OS_Error_t
+ts_batch_init(
+    ts_batch_t*     self,
+    const char*     config,
+    size_t          configLen)
+{
+    Debug_ASSERT_SELF(self);
+    Debug_ASSERT(NULL != config);
+
+    memset(self, 0, sizeof(*self));
+
+    size_t pos = 0;
+    char line[TS_BATCH_MAX_TOPIC_LEN + 32];
+    while (cfg_text_nextLine(config, configLen, &pos, line, sizeof(line)))
+    {
+        if (self->numSeries >= TS_BATCH_MAX_TOPICS)
+        {
+            Debug_LOG_ERROR("too many encoded series, max is %u",
+                            TS_BATCH_MAX_TOPICS);
+            return OS_ERROR_OUT_OF_BOUNDS;
+        }
+
+        OS_Error_t err = parse_line(&self->series[self->numSeries], line);
+        if (OS_SUCCESS != err)
+        {
+            return err;
+        }
+        self->numSeries++;
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+ts_batch_series_t*
+ts_batch_find(
+    ts_batch_t*     self,
+    const char*     topic)
+{
+    Debug_ASSERT_SELF(self);
+
+    for (size_t i = 0; i < self->numSeries; i++)
+    {
+        if (0 == strncmp(self->series[i].topic, topic,
+                         sizeof(self->series[i].topic)))
+        {
+            return &self->series[i];
+        }
+    }
+
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+bool
+ts_batch_addSample(
+    ts_batch_series_t*  series,
+    uint64_t            timestamp_ms,
+    double              value,
+    void*               frame,
+    size_t*             frameLen)
+{
+    Debug_ASSERT(NULL != series);
+    Debug_ASSERT(NULL != frame);
+    Debug_ASSERT(NULL != frameLen);
+
+    OS_Error_t err = ts_encoder_add(&series->encoder, timestamp_ms, value);
+    if (OS_ERROR_BUFFER_TOO_SMALL == err)
+    {
+        // send what we have and start the next frame with this sample, an
+        // empty frame always has space for one sample
+        flush_frame(series, frame, frameLen);
+        err = ts_encoder_add(&series->encoder, timestamp_ms, value);
+        Debug_ASSERT(OS_SUCCESS == err);
+        return true;
+    }
+
+    if (ts_encoder_getCount(&series->encoder) >= series->samplesPerFrame)
+    {
+        flush_frame(series, frame, frameLen);
+        return true;
+    }
+
+    return false;
+}
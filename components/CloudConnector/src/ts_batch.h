@@ -0,0 +1,65 @@
+/*
+ * Batching of numeric samples per topic into encoded frames
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include "ts_codec.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TS_BATCH_MAX_TOPICS         4
+#define TS_BATCH_MAX_TOPIC_LEN      128
+#define TS_BATCH_FRAME_SIZE         512
+
+typedef struct
+{
+    char            topic[TS_BATCH_MAX_TOPIC_LEN];
+    size_t          samplesPerFrame;
+    ts_encoder_t    encoder;
+    uint8_t         frame[TS_BATCH_FRAME_SIZE];
+} ts_batch_series_t;
+
+typedef struct
+{
+    ts_batch_series_t   series[TS_BATCH_MAX_TOPICS];
+    size_t              numSeries;
+} ts_batch_t;
+
+// Set up the encoded series from a text configuration, one per line:
+//
+//   <topic> gorilla <samples_per_frame>
+//
+// Empty lines and lines starting with '#' are ignored.
+OS_Error_t
+ts_batch_init(
+    ts_batch_t*     self,
+    const char*     config,
+    size_t          configLen);
+
+ts_batch_series_t*
+ts_batch_find(
+    ts_batch_t*     self,
+    const char*     topic);
+
+// Add a sample to the frame of the series. Returns true if the frame is
+// complete, either because it holds the configured number of samples or
+// because the sample did not fit anymore. In this case the frame is copied to
+// the given buffer, which must hold at least TS_BATCH_FRAME_SIZE bytes.
+bool
+ts_batch_addSample(
+    ts_batch_series_t*  series,
+    uint64_t            timestamp_ms,
+    double              value,
+    void*               frame,
+    size_t*             frameLen);
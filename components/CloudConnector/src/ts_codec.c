@@ -0,0 +1,503 @@
+/*
+ * Compact encoding of numeric time series
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "ts_codec.h"
+
+#include "lib_debug/Debug.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// The delta-of-delta of the timestamps is stored with a variable length
+// prefix, the ranges are the ones from the Gorilla paper.
+typedef struct
+{
+    unsigned int    prefix;
+    unsigned int    prefixBits;
+    unsigned int    valueBits;
+} dod_class_t;
+
+static const dod_class_t dodClasses[] =
+{
+    { .prefix = 0x2, .prefixBits = 2, .valueBits = 7  },
+    { .prefix = 0x6, .prefixBits = 3, .valueBits = 9  },
+    { .prefix = 0xE, .prefixBits = 4, .valueBits = 12 },
+    { .prefix = 0xF, .prefixBits = 4, .valueBits = 32 },
+};
+
+
+//==============================================================================
+// bit stream
+//==============================================================================
+
+//------------------------------------------------------------------------------
+static bool
+stream_write(
+    ts_bitstream_t* s,
+    uint64_t        value,
+    unsigned int    numBits)
+{
+    if (s->bitPos + numBits > s->bufSize * 8)
+    {
+        return false;
+    }
+
+    for (unsigned int i = numBits; i > 0; i--)
+    {
+        size_t byte = s->bitPos / 8;
+        unsigned int shift = 7 - (s->bitPos % 8);
+
+        if ((value >> (i - 1)) & 1)
+        {
+            s->buf[byte] |= (1U << shift);
+        }
+        else
+        {
+            s->buf[byte] &= ~(1U << shift);
+        }
+        s->bitPos++;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static bool
+stream_read(
+    ts_bitstream_t* s,
+    unsigned int    numBits,
+    uint64_t*       value)
+{
+    if (s->bitPos + numBits > s->bufSize * 8)
+    {
+        return false;
+    }
+
+    uint64_t result = 0;
+    for (unsigned int i = 0; i < numBits; i++)
+    {
+        size_t byte = s->bitPos / 8;
+        unsigned int shift = 7 - (s->bitPos % 8);
+
+        result = (result << 1) | ((s->buf[byte] >> shift) & 1);
+        s->bitPos++;
+    }
+
+    *value = result;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static uint64_t
+double_to_bits(
+    double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+//------------------------------------------------------------------------------
+static double
+bits_to_double(
+    uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//------------------------------------------------------------------------------
+static unsigned int
+count_leading_zeros(
+    uint64_t value)
+{
+    return (0 == value) ? 64 : __builtin_clzll(value);
+}
+
+//------------------------------------------------------------------------------
+static unsigned int
+count_trailing_zeros(
+    uint64_t value)
+{
+    return (0 == value) ? 64 : __builtin_ctzll(value);
+}
+
+
+//==============================================================================
+// encoder
+//==============================================================================
+
+//------------------------------------------------------------------------------
+static bool
+encode_timestamp(
+    ts_encoder_t*   self,
+    uint64_t        timestamp_ms)
+{
+    int64_t delta = (int64_t)(timestamp_ms - self->prevTimestamp);
+    int64_t dod = delta - self->prevDelta;
+
+    self->prevTimestamp = timestamp_ms;
+    self->prevDelta = delta;
+
+    if (0 == dod)
+    {
+        return stream_write(&self->stream, 0, 1);
+    }
+
+    for (size_t i = 0; i < sizeof(dodClasses) / sizeof(dodClasses[0]); i++)
+    {
+        const dod_class_t* c = &dodClasses[i];
+        int64_t limit = ((int64_t)1 << (c->valueBits - 1));
+
+        // the last class takes everything, larger values are truncated
+        if (((dod >= -limit) && (dod < limit)) || (c->valueBits == 32))
+        {
+            uint64_t mask = ((uint64_t)1 << c->valueBits) - 1;
+            return stream_write(&self->stream, c->prefix, c->prefixBits)
+                   && stream_write(&self->stream, (uint64_t)dod & mask,
+                                   c->valueBits);
+        }
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+static bool
+encode_value(
+    ts_encoder_t*   self,
+    double          value)
+{
+    uint64_t bits = double_to_bits(value);
+    uint64_t xor = bits ^ self->prevValue;
+
+    self->prevValue = bits;
+
+    if (0 == xor)
+    {
+        return stream_write(&self->stream, 0, 1);
+    }
+
+    unsigned int leading = count_leading_zeros(xor);
+    unsigned int trailing = count_trailing_zeros(xor);
+
+    // the number of leading zeros is stored with 5 bits
+    if (leading > 31)
+    {
+        leading = 31;
+    }
+
+    // reuse the window of meaningful bits of the previous value if it fits,
+    // there is none before the first non-zero XOR
+    if (((self->prevLeading != 0) || (self->prevTrailing != 0))
+        && (leading >= self->prevLeading)
+        && (trailing >= self->prevTrailing))
+    {
+        unsigned int meaningful = 64 - self->prevLeading - self->prevTrailing;
+        return stream_write(&self->stream, 0x2, 2)
+               && stream_write(&self->stream, xor >> self->prevTrailing,
+                               meaningful);
+    }
+
+    unsigned int meaningful = 64 - leading - trailing;
+
+    self->prevLeading = leading;
+    self->prevTrailing = trailing;
+
+    // a length of 64 does not fit into 6 bits, it is stored as 0
+    return stream_write(&self->stream, 0x3, 2)
+           && stream_write(&self->stream, leading, 5)
+           && stream_write(&self->stream, meaningful & 0x3F, 6)
+           && stream_write(&self->stream, xor >> trailing, meaningful);
+}
+
+//------------------------------------------------------------------------------
+static void
+write_header(
+    ts_encoder_t* self)
+{
+    self->stream.buf[0] = TS_CODEC_FRAME_MAGIC;
+    self->stream.buf[1] = (uint8_t)(self->count & 0xFF);
+    self->stream.buf[2] = (uint8_t)(self->count >> 8);
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+ts_encoder_init(
+    ts_encoder_t*   self,
+    void*           buf,
+    size_t          bufSize)
+{
+    Debug_ASSERT_SELF(self);
+
+    if ((NULL == buf) || (bufSize < TS_CODEC_FRAME_HEADER_SIZE))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    memset(self, 0, sizeof(*self));
+
+    self->stream.buf     = (uint8_t*)buf;
+    self->stream.bufSize = bufSize;
+    self->stream.bitPos  = TS_CODEC_FRAME_HEADER_SIZE * 8;
+
+    write_header(self);
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+ts_encoder_add(
+    ts_encoder_t*   self,
+    uint64_t        timestamp_ms,
+    double          value)
+{
+    Debug_ASSERT_SELF(self);
+
+    if (self->count >= TS_CODEC_MAX_SAMPLES)
+    {
+        return OS_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    // encoding modifies the state, restore it if the sample does not fit
+    ts_encoder_t backup = *self;
+
+    bool isOk;
+    self->count++;
+    if (1 == self->count)
+    {
+        // the first sample is stored uncompressed
+        self->prevTimestamp = timestamp_ms;
+        self->prevValue = double_to_bits(value);
+        isOk = stream_write(&self->stream, timestamp_ms, 64)
+               && stream_write(&self->stream, self->prevValue, 64);
+    }
+    else
+    {
+        isOk = encode_timestamp(self, timestamp_ms)
+               && encode_value(self, value);
+    }
+
+    if (!isOk)
+    {
+        *self = backup;
+        return OS_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    write_header(self);
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+size_t
+ts_encoder_getCount(
+    const ts_encoder_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    return self->count;
+}
+
+//------------------------------------------------------------------------------
+size_t
+ts_encoder_getSize(
+    const ts_encoder_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    return (self->stream.bitPos + 7) / 8;
+}
+
+
+//==============================================================================
+// decoder
+//==============================================================================
+
+//------------------------------------------------------------------------------
+static bool
+decode_timestamp(
+    ts_decoder_t*   self,
+    uint64_t*       timestamp_ms)
+{
+    uint64_t bit;
+    if (!stream_read(&self->stream, 1, &bit))
+    {
+        return false;
+    }
+
+    int64_t dod = 0;
+    if (bit)
+    {
+        // the prefix has as many leading ones as the index of its class
+        size_t i = 0;
+        while (i < sizeof(dodClasses) / sizeof(dodClasses[0]) - 1)
+        {
+            if (!stream_read(&self->stream, 1, &bit))
+            {
+                return false;
+            }
+            if (!bit)
+            {
+                break;
+            }
+            i++;
+        }
+
+        const dod_class_t* c = &dodClasses[i];
+        uint64_t raw;
+        if (!stream_read(&self->stream, c->valueBits, &raw))
+        {
+            return false;
+        }
+
+        // sign extend
+        if (raw & ((uint64_t)1 << (c->valueBits - 1)))
+        {
+            raw |= ~(((uint64_t)1 << c->valueBits) - 1);
+        }
+        dod = (int64_t)raw;
+    }
+
+    self->prevDelta += dod;
+    self->prevTimestamp += self->prevDelta;
+    *timestamp_ms = self->prevTimestamp;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+static bool
+decode_value(
+    ts_decoder_t*   self,
+    double*         value)
+{
+    uint64_t bit;
+    if (!stream_read(&self->stream, 1, &bit))
+    {
+        return false;
+    }
+
+    if (bit)
+    {
+        if (!stream_read(&self->stream, 1, &bit))
+        {
+            return false;
+        }
+
+        if (bit)
+        {
+            uint64_t leading;
+            uint64_t meaningful;
+            if (!stream_read(&self->stream, 5, &leading)
+                || !stream_read(&self->stream, 6, &meaningful))
+            {
+                return false;
+            }
+            if (0 == meaningful)
+            {
+                meaningful = 64;
+            }
+            if (leading + meaningful > 64)
+            {
+                return false;
+            }
+            self->prevLeading = leading;
+            self->prevTrailing = 64 - leading - meaningful;
+        }
+
+        unsigned int numBits = 64 - self->prevLeading - self->prevTrailing;
+        uint64_t xor;
+        if (!stream_read(&self->stream, numBits, &xor))
+        {
+            return false;
+        }
+        self->prevValue ^= (xor << self->prevTrailing);
+    }
+
+    *value = bits_to_double(self->prevValue);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+ts_decoder_init(
+    ts_decoder_t*   self,
+    const void*     frame,
+    size_t          frameSize)
+{
+    Debug_ASSERT_SELF(self);
+
+    if ((NULL == frame) || (frameSize < TS_CODEC_FRAME_HEADER_SIZE))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    const uint8_t* buf = (const uint8_t*)frame;
+    if (buf[0] != TS_CODEC_FRAME_MAGIC)
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    memset(self, 0, sizeof(*self));
+
+    // the decoder never writes to the stream
+    self->stream.buf     = (uint8_t*)buf;
+    self->stream.bufSize = frameSize;
+    self->stream.bitPos  = TS_CODEC_FRAME_HEADER_SIZE * 8;
+    self->count          = buf[1] | (buf[2] << 8);
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+ts_decoder_next(
+    ts_decoder_t*   self,
+    uint64_t*       timestamp_ms,
+    double*         value)
+{
+    Debug_ASSERT_SELF(self);
+
+    if (self->index >= self->count)
+    {
+        return OS_ERROR_NOT_FOUND;
+    }
+
+    bool isOk;
+    if (0 == self->index)
+    {
+        uint64_t bits;
+        isOk = stream_read(&self->stream, 64, &self->prevTimestamp)
+               && stream_read(&self->stream, 64, &bits);
+        self->prevValue = bits;
+        *timestamp_ms = self->prevTimestamp;
+        *value = bits_to_double(bits);
+    }
+    else
+    {
+        isOk = decode_timestamp(self, timestamp_ms)
+               && decode_value(self, value);
+    }
+
+    if (!isOk)
+    {
+        Debug_LOG_ERROR("frame truncated at sample %zu of %zu",
+                        self->index, self->count);
+        return OS_ERROR_OVERFLOW_DETECTED;
+    }
+
+    self->index++;
+
+    return OS_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/*
+ * Compact encoding of numeric time series
+ *
+ * Samples are packed into a frame following the Gorilla scheme: timestamps are
+ * stored as delta-of-delta and values as XOR against the previous value. The
+ * frame starts with a 3 byte header, a magic byte and the number of samples as
+ * 16-bit little endian value, followed by the bit stream.
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TS_CODEC_FRAME_MAGIC        0x47
+#define TS_CODEC_FRAME_HEADER_SIZE  3
+#define TS_CODEC_MAX_SAMPLES        UINT16_MAX
+
+typedef struct
+{
+    uint8_t*    buf;
+    size_t      bufSize;
+    size_t      bitPos;
+} ts_bitstream_t;
+
+typedef struct
+{
+    ts_bitstream_t  stream;
+    size_t          count;
+
+    uint64_t        prevTimestamp;
+    int64_t         prevDelta;
+    uint64_t        prevValue;
+    unsigned int    prevLeading;
+    unsigned int    prevTrailing;
+} ts_encoder_t;
+
+typedef struct
+{
+    ts_bitstream_t  stream;
+    size_t          count;
+    size_t          index;
+
+    uint64_t        prevTimestamp;
+    int64_t         prevDelta;
+    uint64_t        prevValue;
+    unsigned int    prevLeading;
+    unsigned int    prevTrailing;
+} ts_decoder_t;
+
+OS_Error_t
+ts_encoder_init(
+    ts_encoder_t*   self,
+    void*           buf,
+    size_t          bufSize);
+
+// Append a sample to the frame. If it does not fit, OS_ERROR_BUFFER_TOO_SMALL
+// is returned and the frame is left unchanged.
+OS_Error_t
+ts_encoder_add(
+    ts_encoder_t*   self,
+    uint64_t        timestamp_ms,
+    double          value);
+
+size_t
+ts_encoder_getCount(
+    const ts_encoder_t* self);
+
+// Size of the frame in bytes, the last byte is padded with zero bits.
+size_t
+ts_encoder_getSize(
+    const ts_encoder_t* self);
+
+OS_Error_t
+ts_decoder_init(
+    ts_decoder_t*   self,
+    const void*     frame,
+    size_t          frameSize);
+
+// Returns OS_ERROR_NOT_FOUND once all samples of the frame have been read.
+OS_Error_t
+ts_decoder_next(
+    ts_decoder_t*   self,
+    uint64_t*       timestamp_ms,
+    double*         value);
@@ -12,12 +12,538 @@
 #include <camkes.h>
 
 #include "lib_debug/Debug.h"
+#include "TimeServer.h"
 #include "init_config_backend.h"
+#include "config_image.h"
+#include "config_store.h"
+#include "config_batch.h"
+#include "config_snapshot.h"
+#include "system_config.h"
 
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(DEMO_IOT_BENCHMARK)
+void benchmark_ConfigServer_run(void);
+uint64_t benchmark_ConfigServer_batchBegin(void);
+void benchmark_ConfigServer_batchEnd(unsigned int client, const char* name,
+                                     unsigned int numClients,
+                                     uint64_t start_ns);
+#endif
+
+static const if_OS_Timer_t timer =
+    IF_OS_TIMER_ASSIGN(
+        timeServer_rpc,
+        timeServer_notify);
+
+#if defined(DEMO_IOT_LOADGEN)
+#define SENSOR_DOMAIN   "Domain-LoadGen"
+#else
+#define SENSOR_DOMAIN   "Domain-Sensor"
+#endif
+
+// Each client gets a snapshot of its domain in a dataport that it only reads,
+// so it can look up its parameters without any RPC. Clients that apply changes
+// at runtime are notified when a new snapshot changes any of their parameters.
+static const struct
+{
+    const char*     domain;
+    OS_Dataport_t   dataport;
+    void            (*notify)(void);
+} snapshotClients[] =
+{
+    {
+        .domain   = SENSOR_DOMAIN,
+        .dataport = OS_DATAPORT_ASSIGN(sensor_snapshot_port),
+        .notify   = sensor_configChanged_emit
+    },
+    {
+        .domain   = "Domain-CloudConnector",
+        .dataport = OS_DATAPORT_ASSIGN(cloudConnector_snapshot_port),
+        .notify   = cloudConnector_configChanged_emit
+    },
+    {
+        .domain   = "Domain-NwStack",
+        .dataport = OS_DATAPORT_ASSIGN(nwStackConfigurator_snapshot_port),
+        .notify   = NULL
+    },
+    {
+        .domain   = "Domain-SensorHub",
+        .dataport = OS_DATAPORT_ASSIGN(sensorHub_snapshot_port),
+        .notify   = NULL
+    },
+};
+
+// The image is read into the buffer that is not in use, the store switches to
+// it only if it is valid.
+static uint8_t configImages[2][CONFIGSERVER_IMAGE_STORAGE_SIZE]
+__attribute__((aligned(CONFIG_IMAGE_ALIGNMENT)));
+static unsigned int activeImage = 0;
+
+// the image read last, loaded or not, so an invalid one is not read again
+static struct
+{
+    bool        isValid;
+    uint32_t    checksum;
+    uint32_t    imageSize;
+} lastImage;
+
+// Each client of the batch RPC has an interface of its own, so CAmkES serves
+// their requests in separate threads. They read the store without any lock,
+// see config_store.h.
+typedef enum
+{
+    BATCH_CLIENT_CLOUDCONNECTOR,
+    BATCH_CLIENT_SENSOR,
+    BATCH_CLIENT_NWSTACKCONFIGURATOR,
+    BATCH_NUM_CLIENTS
+} batch_client_t;
+
+static const struct
+{
+    const char*     name;
+    OS_Dataport_t   dataport;
+} batchClients[BATCH_NUM_CLIENTS] =
+{
+    [BATCH_CLIENT_CLOUDCONNECTOR] =
+    {
+        .name     = "CloudConnector",
+        .dataport = OS_DATAPORT_ASSIGN(cloudConnector_port)
+    },
+    [BATCH_CLIENT_SENSOR] =
+    {
+        .name     = "Sensor",
+        .dataport = OS_DATAPORT_ASSIGN(sensor_port)
+    },
+    [BATCH_CLIENT_NWSTACKCONFIGURATOR] =
+    {
+        .name     = "NwStackConfigurator",
+        .dataport = OS_DATAPORT_ASSIGN(nwStackConfigurator_port)
+    },
+};
+
+// the previous snapshot of a client, to find the parameters that have changed
+static uint8_t previousSnapshot[4096]
+__attribute__((aligned(CONFIG_SNAPSHOT_ALIGNMENT)));
+
+typedef struct
+{
+    config_snapshot_writer_t    writer;
+    const void*                 previous;
+    size_t                      previousSize;
+    uint32_t                    numMatched;
+    uint32_t                    numChanged;
+} snapshot_ctx_t;
+
+//------------------------------------------------------------------------------
+static uint64_t
+getTime_ms(void)
+{
+    uint64_t now_ms = 0;
+    OS_Error_t err = TimeServer_getTime(&timer, TimeServer_PRECISION_MSEC,
+                                        &now_ms);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("TimeServer_getTime() failed with :%d", err);
+    }
+
+    return now_ms;
+}
+
+//------------------------------------------------------------------------------
+// Read a part of the image from its storage with sequential reads of the
+// dataport size.
+static OS_Error_t
+readImage(
+    size_t      offset,
+    uint8_t*    dst,
+    size_t      len)
+{
+    OS_Dataport_t port = OS_DATAPORT_ASSIGN(imageStorage_port);
+    const uint8_t* buf = OS_Dataport_getBuf(port);
+    const size_t chunkSize = OS_Dataport_getSize(port);
+
+    for (size_t done = 0; done < len; )
+    {
+        size_t size = len - done;
+        if (size > chunkSize)
+        {
+            size = chunkSize;
+        }
+
+        size_t bytesRead = 0;
+        OS_Error_t err = imageStorage_rpc_read(offset + done, size,
+                                               &bytesRead);
+        if ((err != OS_SUCCESS) || (bytesRead != size))
+        {
+            Debug_LOG_ERROR("imageStorage_rpc_read() failed with:%d", err);
+            return (err != OS_SUCCESS) ? err : OS_ERROR_GENERIC;
+        }
+        memcpy(&dst[done], buf, size);
+        done += size;
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// The header gives the size of the whole image.
+static OS_Error_t
+readImageHeader(
+    config_image_header_t* header)
+{
+    OS_Error_t err = readImage(0, (uint8_t*)header, sizeof(*header));
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    if (header->magic != CONFIG_IMAGE_MAGIC)
+    {
+        return OS_ERROR_NOT_FOUND;
+    }
+    if ((header->imageSize < sizeof(*header))
+        || (header->imageSize > sizeof(configImages[0])))
+    {
+        Debug_LOG_ERROR("config image of %u bytes not supported",
+                        header->imageSize);
+        return OS_ERROR_INSUFFICIENT_SPACE;
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+static OS_Error_t
+loadConfigImage(
+    uint8_t*    image,
+    size_t*     len)
+{
+    config_image_header_t header;
+    OS_Error_t err = readImageHeader(&header);
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    memcpy(image, &header, sizeof(header));
+    err = readImage(sizeof(header), &image[sizeof(header)],
+                    header.imageSize - sizeof(header));
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    lastImage.isValid   = true;
+    lastImage.checksum  = header.checksum;
+    lastImage.imageSize = header.imageSize;
+
+    *len = header.imageSize;
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// A parameter keeps its version as long as its value does not change.
+static void
+addToSnapshot(
+    const char*                 name,
+    const config_store_value_t* value,
+    void*                       ctx)
+{
+    snapshot_ctx_t* snapshot = ctx;
+
+    uint32_t version = 1;
+    const void* previousValue;
+    size_t previousLen;
+    uint32_t previousVersion;
+    OS_Error_t err = config_snapshot_find(snapshot->previous,
+                                          snapshot->previousSize,
+                                          name,
+                                          &previousValue,
+                                          &previousLen,
+                                          &previousVersion);
+    if (err == OS_SUCCESS)
+    {
+        snapshot->numMatched++;
+        version = previousVersion;
+        if ((previousLen != value->size)
+            || (0 != memcmp(previousValue, value->value, value->size)))
+        {
+            version++;
+            snapshot->numChanged++;
+        }
+    }
+    else
+    {
+        snapshot->numChanged++;
+    }
+
+    err = config_snapshot_add(&snapshot->writer, name, value->value,
+                              value->size, version);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("parameter %s of %u bytes not in the snapshot",
+                          name, value->size);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void
+publishSnapshots(void)
+{
+    for (size_t i = 0;
+         i < sizeof(snapshotClients) / sizeof(snapshotClients[0]);
+         i++)
+    {
+        const OS_Dataport_t* dataport = &snapshotClients[i].dataport;
+        uint8_t* buf = OS_Dataport_getBuf(*dataport);
+        size_t size = OS_Dataport_getSize(*dataport);
+
+        // only the ConfigServer writes the dataport, the copy is consistent
+        snapshot_ctx_t snapshot =
+        {
+            .previous     = previousSnapshot,
+            .previousSize = (size < sizeof(previousSnapshot))
+                            ? size : sizeof(previousSnapshot),
+        };
+        memcpy(previousSnapshot, buf, snapshot.previousSize);
+        const config_snapshot_header_t* previousHeader =
+            (const config_snapshot_header_t*)previousSnapshot;
+        const bool isUpdate = (previousHeader->magic == CONFIG_SNAPSHOT_MAGIC);
+
+        OS_Error_t err = config_snapshot_beginWrite(
+                             &snapshot.writer,
+                             buf,
+                             size,
+                             snapshotClients[i].domain);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("config_snapshot_beginWrite() failed with:%d", err);
+            continue;
+        }
+
+        const config_store_view_t* view = config_store_acquire();
+        if (NULL != view)
+        {
+            config_store_forEachInDomain(view, snapshotClients[i].domain,
+                                         addToSnapshot, &snapshot);
+            config_store_release(view);
+        }
+        config_snapshot_endWrite(&snapshot.writer);
+
+        if (!isUpdate)
+        {
+            Debug_LOG_INFO("snapshot of %s with %u parameters published",
+                           snapshotClients[i].domain,
+                           snapshot.writer.numEntries);
+            continue;
+        }
+
+        // parameters that have been removed count as changed as well
+        const uint32_t numChanged = snapshot.numChanged
+                                    + previousHeader->numEntries
+                                    - snapshot.numMatched;
+        Debug_LOG_INFO("snapshot of %s with %u parameters published, %u "
+                       "changed", snapshotClients[i].domain,
+                       snapshot.writer.numEntries, numChanged);
+
+        if ((numChanged > 0) && (NULL != snapshotClients[i].notify))
+        {
+            snapshotClients[i].notify();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Load a new image, if one has been written to the storage. The clients get
+// new snapshots then.
+static void
+reloadConfigImage(void)
+{
+    config_image_header_t header;
+    OS_Error_t err = readImageHeader(&header);
+    if (err != OS_SUCCESS)
+    {
+        // keep the current configuration
+        return;
+    }
+
+    if (lastImage.isValid && (header.checksum == lastImage.checksum)
+        && (header.imageSize == lastImage.imageSize))
+    {
+        return;
+    }
+
+    const uint64_t start_ms = getTime_ms();
+
+    uint8_t* image = configImages[activeImage ^ 1];
+    size_t imageLen = 0;
+    err = loadConfigImage(image, &imageLen);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("loading the new config image failed with:%d", err);
+        return;
+    }
+
+    err = config_store_loadImage(image, imageLen);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("new config image rejected with:%d", err);
+        return;
+    }
+
+    // the previous image is overwritten with the next reload, the requests
+    // that are still served from it take a few microseconds only
+    while (config_store_isPreviousInUse())
+    {
+        seL4_Yield();
+    }
+    activeImage ^= 1;
+
+    Debug_LOG_INFO("config image of %zu bytes reloaded in %" PRIu64 " ms",
+                   imageLen, getTime_ms() - start_ms);
+
+    publishSnapshots();
+}
+
+//------------------------------------------------------------------------------
+static void
+handleRequest(
+    const config_store_view_t*      view,
+    const config_batch_request_t*   request,
+    config_batch_reply_t*           reply,
+    uint8_t*                        data,
+    size_t*                         dataUsed,
+    size_t                          dataSize)
+{
+    memset(reply, 0, sizeof(*reply));
+
+    // the names come from the client, they need not be terminated
+    char domain[OS_CONFIG_LIB_DOMAIN_NAME_SIZE];
+    char name[OS_CONFIG_LIB_PARAMETER_NAME_SIZE];
+    memcpy(domain, request->domain, sizeof(domain));
+    domain[sizeof(domain) - 1] = '\0';
+    memcpy(name, request->parameter, sizeof(name));
+    name[sizeof(name) - 1] = '\0';
+
+    config_store_value_t entry;
+    if (!config_store_find(view, domain, name, &entry))
+    {
+        reply->err = OS_ERROR_CONFIG_PARAMETER_NOT_FOUND;
+        return;
+    }
+
+    reply->size = entry.size;
+    if (request->offset > entry.size)
+    {
+        reply->err = OS_ERROR_INVALID_PARAMETER;
+        return;
+    }
+
+    // the value is returned in part, if it does not fit
+    size_t len = entry.size - request->offset;
+    if (len > dataSize - *dataUsed)
+    {
+        len = dataSize - *dataUsed;
+    }
+
+    memcpy(&data[*dataUsed], (const uint8_t*)entry.value + request->offset,
+           len);
+
+    reply->err        = OS_SUCCESS;
+    reply->offset     = request->offset;
+    reply->len        = (uint32_t)len;
+    reply->dataOffset = (uint32_t)*dataUsed;
+
+    *dataUsed = (*dataUsed + len + CONFIG_BATCH_ALIGNMENT - 1)
+                & ~((size_t)CONFIG_BATCH_ALIGNMENT - 1);
+    if (*dataUsed > dataSize)
+    {
+        *dataUsed = dataSize;
+    }
+}
+
+//------------------------------------------------------------------------------
+static OS_Error_t
+getParameters(
+    batch_client_t  client,
+    uint32_t        numRequests)
+{
+    const OS_Dataport_t dataport = batchClients[client].dataport;
+    uint8_t* port = OS_Dataport_getBuf(dataport);
+    const size_t portSize = OS_Dataport_getSize(dataport);
+    const size_t repliesSize = numRequests * sizeof(config_batch_reply_t);
+    if ((0 == numRequests) || (numRequests > CONFIG_BATCH_MAX_REQUESTS)
+        || (numRequests * sizeof(config_batch_request_t) > portSize))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    // the requests are overwritten by the replies, the client could also
+    // change them meanwhile
+    config_batch_request_t requests[CONFIG_BATCH_MAX_REQUESTS];
+    memcpy(requests, port, numRequests * sizeof(config_batch_request_t));
+
+    const config_store_view_t* view = config_store_acquire();
+    if (NULL == view)
+    {
+        return OS_ERROR_INVALID_STATE;
+    }
+
+#if defined(DEMO_IOT_BENCHMARK)
+    const uint64_t start_ns = benchmark_ConfigServer_batchBegin();
+#endif
+
+    config_batch_reply_t* replies = (config_batch_reply_t*)port;
+    size_t dataUsed = repliesSize;
+    for (uint32_t i = 0; i < numRequests; i++)
+    {
+        handleRequest(view, &requests[i], &replies[i], port, &dataUsed,
+                      portSize);
+    }
+
+    config_store_release(view);
+
+#if defined(DEMO_IOT_BENCHMARK)
+    benchmark_ConfigServer_batchEnd(client, batchClients[client].name,
+                                    BATCH_NUM_CLIENTS, start_ns);
+#endif
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+cloudConnector_configBatch_rpc_getParameters(
+    uint32_t numRequests)
+{
+    return getParameters(BATCH_CLIENT_CLOUDCONNECTOR, numRequests);
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+sensor_configBatch_rpc_getParameters(
+    uint32_t numRequests)
+{
+    return getParameters(BATCH_CLIENT_SENSOR, numRequests);
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+nwStackConfigurator_configBatch_rpc_getParameters(
+    uint32_t numRequests)
+{
+    return getParameters(BATCH_CLIENT_NWSTACKCONFIGURATOR, numRequests);
+}
+
+//------------------------------------------------------------------------------
 void post_init(void)
 {
     Debug_LOG_INFO("Starting ConfigServer...");
 
+    const uint64_t start_ms = getTime_ms();
+
     OS_Error_t err = init_system_config_backend();
     if (err != OS_SUCCESS)
     {
@@ -25,7 +551,88 @@ void post_init(void)
         return;
     }
 
+    const uint64_t files_ms = getTime_ms();
+
+    // lookups read the files if this fails
+    size_t preloadSize = 0;
+    err = preload_system_config_backend(&preloadSize);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("preload_system_config_backend() failed with:%d",
+                          err);
+    }
+
+    const uint64_t preload_ms = getTime_ms();
+
+    Debug_LOG_INFO("files ready after %" PRIu64 " ms, %zu bytes preloaded "
+                   "in %" PRIu64 " ms", files_ms - start_ms, preloadSize,
+                   preload_ms - files_ms);
+
+#if defined(DEMO_IOT_BENCHMARK)
+    benchmark_ConfigServer_run();
+#endif
+
+    OS_ConfigServiceHandle_t hConfig;
+    err = OS_ConfigService_createHandleLocal(&hConfig);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("OS_ConfigService_createHandleLocal() failed with:%d",
+                        err);
+        return;
+    }
+
+    // The image is preferred, it needs no scan of all domains. A failure only
+    // disables the batch RPC.
+    const uint64_t image_ms = getTime_ms();
+    size_t imageLen = 0;
+    err = loadConfigImage(configImages[activeImage], &imageLen);
+    if (err == OS_SUCCESS)
+    {
+        err = config_store_loadImage(configImages[activeImage], imageLen);
+    }
+    if (err == OS_SUCCESS)
+    {
+        Debug_LOG_INFO("config image of %zu bytes loaded in %" PRIu64 " ms",
+                       imageLen, getTime_ms() - image_ms);
+    }
+    else
+    {
+        Debug_LOG_INFO("no config image (%d), using the config library", err);
+        err = config_store_load(hConfig);
+    }
+
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("loading the config store failed with:%d", err);
+    }
+    else
+    {
+        publishSnapshots();
+    }
+
     Debug_LOG_INFO("Config Server initialized.");
 
     return;
 }
+
+//------------------------------------------------------------------------------
+int run()
+{
+#if (CONFIGSERVER_RELOAD_PERIOD_MS > 0)
+    // a new image in the storage replaces the configuration without a reboot
+    for (;;)
+    {
+        OS_Error_t err = TimeServer_sleep(&timer,
+                                          TimeServer_PRECISION_MSEC,
+                                          CONFIGSERVER_RELOAD_PERIOD_MS);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_WARNING("TimeServer_sleep() failed with %d", err);
+        }
+
+        reloadConfigImage();
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,339 @@
+/*
+ * Built-in benchmark of the ConfigServer, it is run at startup if
+ * DEMO_IOT_BENCHMARK is defined in the system configuration.
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include <camkes.h>
+
+#include "lib_debug/Debug.h"
+#include "TimeServer.h"
+#include "init_config_backend.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCHMARK_MAX_PARAMETERS    64
+#define BENCHMARK_LOOKUP_ROUNDS     10
+#define BENCHMARK_VALUE_SIZE        (8 * 1024)
+#define BENCHMARK_BATCH_MAX_CLIENTS 4
+
+typedef struct
+{
+    OS_ConfigServiceLibTypes_DomainName_t       domain;
+    OS_ConfigServiceLibTypes_ParameterName_t    parameter;
+} benchmark_name_t;
+
+static benchmark_name_t names[BENCHMARK_MAX_PARAMETERS];
+static uint8_t value[BENCHMARK_VALUE_SIZE];
+
+// Startup contention of the batch RPC. The clients fetch their parameters at
+// the same time at boot, each one in a thread of its own. The report shows
+// when they were served and how many requests overlapped.
+static struct
+{
+    struct
+    {
+        const char* name;
+        uint32_t    numRequests;
+        uint64_t    first_ns;   // arrival of the first request
+        uint64_t    busy_ns;    // time spent serving the requests
+    } clients[BENCHMARK_BATCH_MAX_CLIENTS];
+    uint32_t    numServed;      // clients with at least one request
+    uint32_t    inFlight;
+    uint32_t    peakInFlight;
+} contention;
+
+static const if_OS_Timer_t timer =
+    IF_OS_TIMER_ASSIGN(
+        timeServer_rpc,
+        timeServer_notify);
+
+
+//------------------------------------------------------------------------------
+static uint64_t
+get_time_ns(void)
+{
+    uint64_t now_ns = 0;
+    TimeServer_getTime(&timer, TimeServer_PRECISION_NSEC, &now_ns);
+    return now_ns;
+}
+
+//------------------------------------------------------------------------------
+// Get the names of all parameters, they are looked up by name then like the
+// clients do it.
+static size_t
+collect_names(
+    OS_ConfigServiceHandle_t handle)
+{
+    size_t num = 0;
+
+    OS_ConfigServiceLibTypes_DomainEnumerator_t domainEnumerator = {0};
+    if (OS_SUCCESS != OS_ConfigService_domainEnumeratorInit(handle,
+                                                            &domainEnumerator))
+    {
+        return 0;
+    }
+
+    do
+    {
+        OS_ConfigServiceLibTypes_Domain_t domain;
+        OS_ConfigServiceLibTypes_DomainName_t domainName;
+        if (OS_SUCCESS != OS_ConfigService_domainEnumeratorGetElement(
+                handle, &domainEnumerator, &domain))
+        {
+            break;
+        }
+        OS_ConfigService_domainGetName(&domain, &domainName);
+
+        OS_ConfigServiceLibTypes_ParameterEnumerator_t enumerator = {0};
+        if (OS_SUCCESS != OS_ConfigService_parameterEnumeratorInit(
+                handle, &domainEnumerator, &enumerator))
+        {
+            break;
+        }
+
+        do
+        {
+            OS_ConfigServiceLibTypes_Parameter_t parameter;
+            if ((num >= BENCHMARK_MAX_PARAMETERS)
+                || (OS_SUCCESS != OS_ConfigService_parameterEnumeratorGetElement(
+                        handle, &enumerator, &parameter)))
+            {
+                break;
+            }
+            names[num].domain = domainName;
+            OS_ConfigService_parameterGetName(&parameter,
+                                              &names[num].parameter);
+            num++;
+        }
+        while (OS_SUCCESS == OS_ConfigService_parameterEnumeratorIncrement(
+                   handle, &enumerator));
+    }
+    while (OS_SUCCESS == OS_ConfigService_domainEnumeratorIncrement(
+               handle, &domainEnumerator));
+
+    return num;
+}
+
+//------------------------------------------------------------------------------
+// Same steps as helper_func_getConfigParameter() without the cache.
+static OS_Error_t
+lookup(
+    OS_ConfigServiceHandle_t    handle,
+    const benchmark_name_t*     name)
+{
+    OS_ConfigServiceLibTypes_DomainEnumerator_t enumerator = {0};
+    OS_ConfigServiceLibTypes_Domain_t domain;
+    OS_ConfigServiceLibTypes_Parameter_t parameter;
+
+    OS_Error_t err = OS_ConfigService_domainEnumeratorInit(handle, &enumerator);
+    for (;;)
+    {
+        if (OS_SUCCESS != err)
+        {
+            return err;
+        }
+        err = OS_ConfigService_domainEnumeratorGetElement(handle, &enumerator,
+                                                          &domain);
+        if (OS_SUCCESS != err)
+        {
+            return err;
+        }
+
+        OS_ConfigServiceLibTypes_DomainName_t domainName;
+        OS_ConfigService_domainGetName(&domain, &domainName);
+        if (0 == strncmp(domainName.name, name->domain.name,
+                         OS_CONFIG_LIB_DOMAIN_NAME_SIZE))
+        {
+            break;
+        }
+        err = OS_ConfigService_domainEnumeratorIncrement(handle, &enumerator);
+    }
+
+    err = OS_ConfigService_domainGetElement(handle, &domain, &name->parameter,
+                                            &parameter);
+    if (OS_SUCCESS != err)
+    {
+        return err;
+    }
+
+    size_t bytesCopied;
+    return OS_ConfigService_parameterGetValue(handle, &parameter, value,
+                                              sizeof(value), &bytesCopied);
+}
+
+//------------------------------------------------------------------------------
+static void
+benchmark_lookups(
+    OS_ConfigServiceHandle_t    handle,
+    const char*                 backend,
+    size_t                      numNames)
+{
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+    uint64_t sum_ns = 0;
+    size_t numLookups = 0;
+
+    for (unsigned int round = 0; round < BENCHMARK_LOOKUP_ROUNDS; round++)
+    {
+        for (size_t i = 0; i < numNames; i++)
+        {
+            const uint64_t start_ns = get_time_ns();
+            OS_Error_t err = lookup(handle, &names[i]);
+            const uint64_t duration_ns = get_time_ns() - start_ns;
+            if (OS_SUCCESS != err)
+            {
+                Debug_LOG_ERROR("lookup of %s failed with %d",
+                                names[i].parameter.name, err);
+                return;
+            }
+
+            min_ns = (duration_ns < min_ns) ? duration_ns : min_ns;
+            max_ns = (duration_ns > max_ns) ? duration_ns : max_ns;
+            sum_ns += duration_ns;
+            numLookups++;
+        }
+    }
+
+    if (0 == numLookups)
+    {
+        return;
+    }
+
+    Debug_LOG_INFO("lookups (%s): %zu lookups, min %" PRIu64 " us, "
+                   "mean %" PRIu64 " us, max %" PRIu64 " us",
+                   backend, numLookups, min_ns / NS_IN_US,
+                   sum_ns / numLookups / NS_IN_US, max_ns / NS_IN_US);
+}
+
+//------------------------------------------------------------------------------
+void
+benchmark_ConfigServer_run(void)
+{
+    Debug_LOG_INFO("Running ConfigServer benchmarks...");
+
+    OS_ConfigServiceHandle_t handle;
+    OS_Error_t err = OS_ConfigService_createHandleLocal(&handle);
+    if (OS_SUCCESS != err)
+    {
+        Debug_LOG_ERROR("OS_ConfigService_createHandleLocal() failed with %d",
+                        err);
+        return;
+    }
+
+    const size_t numNames = collect_names(handle);
+
+    if (OS_SUCCESS == select_system_config_backend(CONFIG_BACKEND_FILE))
+    {
+        benchmark_lookups(handle, "file", numNames);
+    }
+
+    // the RAM backend stays in use, if there is one
+    if (OS_SUCCESS == select_system_config_backend(CONFIG_BACKEND_RAM))
+    {
+        benchmark_lookups(handle, "RAM", numNames);
+    }
+    else
+    {
+        Debug_LOG_INFO("lookups (RAM): not preloaded");
+    }
+
+    Debug_LOG_INFO("ConfigServer benchmarks done");
+}
+
+//------------------------------------------------------------------------------
+// Called by the RPC thread of a batch client before it serves a request.
+uint64_t
+benchmark_ConfigServer_batchBegin(void)
+{
+    const uint32_t inFlight = __atomic_add_fetch(&contention.inFlight, 1,
+                                                 __ATOMIC_RELAXED);
+    uint32_t peak = __atomic_load_n(&contention.peakInFlight, __ATOMIC_RELAXED);
+    while ((inFlight > peak)
+           && !__atomic_compare_exchange_n(&contention.peakInFlight, &peak,
+                                           inFlight, false, __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED))
+    {
+        // peak has been updated, try again
+    }
+
+    return get_time_ns();
+}
+
+//------------------------------------------------------------------------------
+// Called by the RPC thread of a batch client after it has served a request.
+// Once every client has been served, the report is logged.
+void
+benchmark_ConfigServer_batchEnd(
+    unsigned int    client,
+    const char*     name,
+    unsigned int    numClients,
+    uint64_t        start_ns)
+{
+    const uint64_t end_ns = get_time_ns();
+
+    __atomic_sub_fetch(&contention.inFlight, 1, __ATOMIC_RELAXED);
+
+    if ((client >= BENCHMARK_BATCH_MAX_CLIENTS)
+        || (numClients > BENCHMARK_BATCH_MAX_CLIENTS))
+    {
+        return;
+    }
+
+    // only the thread of this client writes its entry
+    if (0 == contention.clients[client].numRequests)
+    {
+        contention.clients[client].name     = name;
+        contention.clients[client].first_ns = start_ns;
+    }
+    contention.clients[client].numRequests++;
+    contention.clients[client].busy_ns += end_ns - start_ns;
+
+    Debug_LOG_INFO("batch (%s): request #%u served in %" PRIu64 " us",
+                   name, contention.clients[client].numRequests,
+                   (end_ns - start_ns) / NS_IN_US);
+
+    if (contention.clients[client].numRequests > 1)
+    {
+        return;
+    }
+
+    // the client that is served first for the last one logs the report
+    if (__atomic_add_fetch(&contention.numServed, 1, __ATOMIC_ACQ_REL)
+        != numClients)
+    {
+        return;
+    }
+
+    uint64_t first_ns = UINT64_MAX;
+    for (unsigned int i = 0; i < numClients; i++)
+    {
+        if (contention.clients[i].first_ns < first_ns)
+        {
+            first_ns = contention.clients[i].first_ns;
+        }
+    }
+
+    for (unsigned int i = 0; i < numClients; i++)
+    {
+        Debug_LOG_INFO("startup contention (%s): served %" PRIu64
+                       " us after the first client, %u requests in %" PRIu64
+                       " us", contention.clients[i].name,
+                       (contention.clients[i].first_ns - first_ns) / NS_IN_US,
+                       contention.clients[i].numRequests,
+                       contention.clients[i].busy_ns / NS_IN_US);
+    }
+    Debug_LOG_INFO("startup contention: %u clients served within %" PRIu64
+                   " us, up to %u requests at the same time", numClients,
+                   (end_ns - first_ns) / NS_IN_US,
+                   __atomic_load_n(&contention.peakInFlight,
+                                   __ATOMIC_RELAXED));
+}
@@ -0,0 +1,178 @@
+/*
+ * Read-only configuration image with a perfect hash index
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "config_image.h"
+
+#include "lib_debug/Debug.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// FNV-1a, the seed is mixed into the offset basis
+#define HASH_OFFSET_BASIS   2166136261u
+#define HASH_PRIME          16777619u
+
+//------------------------------------------------------------------------------
+static uint32_t
+hashBytes(
+    uint32_t    hash,
+    const char* s,
+    size_t      maxLen)
+{
+    for (size_t i = 0; (i < maxLen) && (s[i] != '\0'); i++)
+    {
+        hash = (hash ^ (uint8_t)s[i]) * HASH_PRIME;
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+// Hash of "domain/parameter", must match hash_key() of the image tool.
+static uint32_t
+hashKey(
+    uint32_t    seed,
+    const char* domain,
+    const char* parameter)
+{
+    uint32_t hash = (HASH_OFFSET_BASIS ^ seed) * HASH_PRIME;
+    hash = hashBytes(hash, domain, CONFIG_IMAGE_NAME_SIZE);
+    hash = (hash ^ '/') * HASH_PRIME;
+    return hashBytes(hash, parameter, CONFIG_IMAGE_NAME_SIZE);
+}
+
+//------------------------------------------------------------------------------
+static bool
+isInImage(
+    uint32_t    offset,
+    size_t      len,
+    uint32_t    imageSize)
+{
+    return (offset <= imageSize) && (len <= imageSize - offset);
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+config_image_init(
+    config_image_t* self,
+    const void*     image,
+    size_t          len)
+{
+    Debug_ASSERT_SELF(self);
+
+    const config_image_header_t* header = image;
+    if ((NULL == image) || (len < sizeof(*header))
+        || (((uintptr_t)image % CONFIG_IMAGE_ALIGNMENT) != 0))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if ((header->magic != CONFIG_IMAGE_MAGIC)
+        || (header->version != CONFIG_IMAGE_VERSION)
+        || (header->headerSize != sizeof(*header)))
+    {
+        Debug_LOG_ERROR("no config image of version %d", CONFIG_IMAGE_VERSION);
+        return OS_ERROR_NOT_SUPPORTED;
+    }
+
+    const uint32_t imageSize = header->imageSize;
+    if ((imageSize > len) || (imageSize < sizeof(*header))
+        || (0 == header->numEntries) || (0 == header->numBuckets)
+        || ((header->bucketsOffset % sizeof(int32_t)) != 0)
+        || ((header->entriesOffset % CONFIG_IMAGE_ALIGNMENT) != 0)
+        || !isInImage(header->bucketsOffset,
+                      (size_t)header->numBuckets * sizeof(int32_t), imageSize)
+        || !isInImage(header->entriesOffset,
+                      (size_t)header->numEntries
+                      * sizeof(config_image_entry_t), imageSize))
+    {
+        Debug_LOG_ERROR("invalid config image layout");
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    const uint8_t* base = image;
+    uint32_t checksum = HASH_OFFSET_BASIS;
+    for (size_t i = sizeof(*header); i < imageSize; i++)
+    {
+        checksum = (checksum ^ base[i]) * HASH_PRIME;
+    }
+    if (checksum != header->checksum)
+    {
+        Debug_LOG_ERROR("config image checksum mismatch");
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    self->base    = base;
+    self->header  = header;
+    self->buckets = (const int32_t*)&base[header->bucketsOffset];
+    self->entries = (const config_image_entry_t*)&base[header->entriesOffset];
+
+    // checked once here, so the lookups can trust the image
+    for (uint32_t i = 0; i < header->numBuckets; i++)
+    {
+        const int32_t d = self->buckets[i];
+        if ((d < 0) && ((uint32_t)(-(d + 1)) >= header->numEntries))
+        {
+            Debug_LOG_ERROR("invalid displacement in bucket %u", i);
+            return OS_ERROR_INVALID_STATE;
+        }
+    }
+    for (uint32_t i = 0; i < header->numEntries; i++)
+    {
+        const config_image_entry_t* entry = &self->entries[i];
+        if (((entry->valueOffset % CONFIG_IMAGE_ALIGNMENT) != 0)
+            || !isInImage(entry->valueOffset, entry->size, imageSize))
+        {
+            Debug_LOG_ERROR("invalid value of entry %u", i);
+            return OS_ERROR_INVALID_STATE;
+        }
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+const config_image_entry_t*
+config_image_find(
+    const config_image_t*   self,
+    const char*             domain,
+    const char*             parameter)
+{
+    Debug_ASSERT_SELF(self);
+
+    const config_image_header_t* header = self->header;
+
+    const uint32_t bucket = hashKey(0, domain, parameter) % header->numBuckets;
+    const int32_t d = self->buckets[bucket];
+    const uint32_t index = (d < 0) ? (uint32_t)(-(d + 1))
+                           : hashKey((uint32_t)d, domain, parameter)
+                           % header->numEntries;
+
+    // keys that are not in the image map to some entry as well
+    const config_image_entry_t* entry = &self->entries[index];
+    if ((0 != strncmp(entry->domain, domain, CONFIG_IMAGE_NAME_SIZE))
+        || (0 != strncmp(entry->parameter, parameter, CONFIG_IMAGE_NAME_SIZE)))
+    {
+        return NULL;
+    }
+
+    return entry;
+}
+
+//------------------------------------------------------------------------------
+const void*
+config_image_getValue(
+    const config_image_t*       self,
+    const config_image_entry_t* entry)
+{
+    Debug_ASSERT_SELF(self);
+
+    return &self->base[entry->valueOffset];
+}
@@ -0,0 +1,97 @@
+/*
+ * Read-only configuration image with a perfect hash index
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The image is created from config.xml by tools/config_image.py, both sides
+// must agree on this layout. All fields are little endian, all offsets are
+// from the start of the image.
+//
+//   header
+//   int32_t  displacement[numBuckets]
+//   config_image_entry_t entry[numEntries]
+//   values, each aligned to CONFIG_IMAGE_ALIGNMENT
+//
+// A key "domain/parameter" is hashed with seed 0 to find its bucket. If the
+// displacement d of the bucket is negative, the entry is at index -d - 1,
+// otherwise the key is hashed again with seed d to get the index. Every index
+// is used by exactly one key, so the names of the entry are compared once.
+#define CONFIG_IMAGE_MAGIC      0x49474643  // "CFGI"
+#define CONFIG_IMAGE_VERSION    1
+#define CONFIG_IMAGE_ALIGNMENT  8
+#define CONFIG_IMAGE_NAME_SIZE  32
+
+typedef enum
+{
+    CONFIG_IMAGE_TYPE_INT32,
+    CONFIG_IMAGE_TYPE_INT64,
+    CONFIG_IMAGE_TYPE_STRING,
+    CONFIG_IMAGE_TYPE_BLOB
+} config_image_type_t;
+
+typedef struct
+{
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    headerSize;
+    uint32_t    imageSize;
+    uint32_t    checksum;   // FNV-1a over everything after the header
+    uint32_t    numEntries;
+    uint32_t    numBuckets;
+    uint32_t    bucketsOffset;
+    uint32_t    entriesOffset;
+    uint32_t    valuesOffset;
+    uint32_t    reserved;
+} config_image_header_t;
+
+typedef struct
+{
+    char        domain[CONFIG_IMAGE_NAME_SIZE];
+    char        parameter[CONFIG_IMAGE_NAME_SIZE];
+    uint32_t    type;       // config_image_type_t
+    uint32_t    size;
+    uint32_t    valueOffset;
+    uint32_t    reserved;
+} config_image_entry_t;
+
+typedef struct
+{
+    const uint8_t*                  base;
+    const config_image_header_t*    header;
+    const int32_t*                  buckets;
+    const config_image_entry_t*     entries;
+} config_image_t;
+
+
+//------------------------------------------------------------------------------
+// Check the header, the checksum and all offsets of an image in memory. It
+// must stay there, the lookups return pointers into it.
+OS_Error_t
+config_image_init(
+    config_image_t* self,
+    const void*     image,
+    size_t          len);
+
+// Returns NULL if there is no such parameter.
+const config_image_entry_t*
+config_image_find(
+    const config_image_t*   self,
+    const char*             domain,
+    const char*             parameter);
+
+const void*
+config_image_getValue(
+    const config_image_t*       self,
+    const config_image_entry_t* entry);
@@ -0,0 +1,311 @@
+/*
+ * Read-only copy of all configuration parameters in RAM
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "config_store.h"
+
+#include "lib_debug/Debug.h"
+
+#include <string.h>
+
+// The parameters copied from the config library don't change, a view uses
+// them if it has no image. Readers use the current view, a new image is put
+// into the other one.
+static struct
+{
+    config_store_entry_t    entries[CONFIG_STORE_MAX_PARAMETERS];
+    size_t                  numEntries;
+    uint8_t                 arena[CONFIG_STORE_ARENA_SIZE];
+    size_t                  arenaUsed;
+    config_store_view_t     views[2];
+    uint32_t                current;
+} store;
+
+//------------------------------------------------------------------------------
+static OS_Error_t
+loadDomain(
+    OS_ConfigServiceHandle_t                            handle,
+    OS_ConfigServiceLibTypes_DomainEnumerator_t const*  domainEnumerator,
+    OS_ConfigServiceLibTypes_DomainName_t const*        domainName)
+{
+    OS_ConfigServiceLibTypes_ParameterEnumerator_t enumerator = {0};
+    OS_Error_t err = OS_ConfigService_parameterEnumeratorInit(handle,
+                                                              domainEnumerator,
+                                                              &enumerator);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("parameterEnumeratorInit() failed with %d", err);
+        return err;
+    }
+
+    do
+    {
+        OS_ConfigServiceLibTypes_Parameter_t parameter;
+        err = OS_ConfigService_parameterEnumeratorGetElement(handle,
+                                                             &enumerator,
+                                                             &parameter);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("parameterEnumeratorGetElement() failed with %d",
+                            err);
+            return err;
+        }
+
+        if (store.numEntries >= CONFIG_STORE_MAX_PARAMETERS)
+        {
+            Debug_LOG_ERROR("more than %d parameters",
+                            CONFIG_STORE_MAX_PARAMETERS);
+            return OS_ERROR_INSUFFICIENT_SPACE;
+        }
+
+        size_t size = OS_ConfigService_parameterGetSize(&parameter);
+        if (size > sizeof(store.arena) - store.arenaUsed)
+        {
+            Debug_LOG_ERROR("no space for a value of %zu bytes", size);
+            return OS_ERROR_INSUFFICIENT_SPACE;
+        }
+
+        config_store_entry_t* entry = &store.entries[store.numEntries];
+        void* value = &store.arena[store.arenaUsed];
+        size_t bytesCopied;
+        err = OS_ConfigService_parameterGetValue(handle, &parameter, value,
+                                                 size, &bytesCopied);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("parameterGetValue() failed with %d", err);
+            return err;
+        }
+
+        OS_ConfigServiceLibTypes_ParameterName_t name;
+        OS_ConfigService_parameterGetName(&parameter, &name);
+        OS_ConfigServiceLibTypes_ParameterType_t type;
+        OS_ConfigService_parameterGetType(&parameter, &type);
+
+        memcpy(entry->domain, domainName->name, sizeof(entry->domain));
+        memcpy(entry->name, name.name, sizeof(entry->name));
+        entry->type  = (uint32_t)type;
+        entry->size  = (uint32_t)bytesCopied;
+        entry->value = value;
+
+        store.arenaUsed += (bytesCopied + 7) & ~(size_t)7;
+        store.numEntries++;
+    }
+    // the enumerator fails at the end of the domain
+    while (OS_ConfigService_parameterEnumeratorIncrement(handle, &enumerator)
+           == OS_SUCCESS);
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+config_store_load(
+    OS_ConfigServiceHandle_t handle)
+{
+    OS_ConfigServiceLibTypes_DomainEnumerator_t enumerator = {0};
+    OS_Error_t err = OS_ConfigService_domainEnumeratorInit(handle, &enumerator);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("domainEnumeratorInit() failed with %d", err);
+        return err;
+    }
+
+    do
+    {
+        OS_ConfigServiceLibTypes_Domain_t domain;
+        err = OS_ConfigService_domainEnumeratorGetElement(handle, &enumerator,
+                                                          &domain);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("domainEnumeratorGetElement() failed with %d", err);
+            return err;
+        }
+
+        OS_ConfigServiceLibTypes_DomainName_t domainName;
+        OS_ConfigService_domainGetName(&domain, &domainName);
+
+        err = loadDomain(handle, &enumerator, &domainName);
+        if (err != OS_SUCCESS)
+        {
+            return err;
+        }
+    }
+    while (OS_ConfigService_domainEnumeratorIncrement(handle, &enumerator)
+           == OS_SUCCESS);
+
+    store.views[store.current].isLoaded = true;
+    store.views[store.current].isImage  = false;
+
+    Debug_LOG_INFO("%zu parameters with %zu bytes of values loaded",
+                   store.numEntries, store.arenaUsed);
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+config_store_loadImage(
+    const void* image,
+    size_t      len)
+{
+    // an invalid image leaves the store as it is
+    config_image_t newImage;
+    OS_Error_t err = config_image_init(&newImage, image, len);
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    // A reader that has taken this view before it was replaced the last time
+    // sees that it is not current anymore and does not read it.
+    const uint32_t next = store.current ^ 1;
+    config_store_view_t* view = &store.views[next];
+    view->image    = newImage;
+    view->isImage  = true;
+    view->isLoaded = true;
+
+    // readers that take the view from now on see it completely
+    __atomic_store_n(&store.current, next, __ATOMIC_SEQ_CST);
+
+    Debug_LOG_INFO("config image with %u parameters loaded",
+                   newImage.header->numEntries);
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+bool
+config_store_isPreviousInUse(void)
+{
+    const config_store_view_t* previous = &store.views[store.current ^ 1];
+
+    return (__atomic_load_n(&previous->numReaders, __ATOMIC_SEQ_CST) > 0);
+}
+
+//------------------------------------------------------------------------------
+const config_store_view_t*
+config_store_acquire(void)
+{
+    for (;;)
+    {
+        const uint32_t current = __atomic_load_n(&store.current,
+                                                 __ATOMIC_SEQ_CST);
+        config_store_view_t* view = &store.views[current];
+        __atomic_add_fetch(&view->numReaders, 1, __ATOMIC_SEQ_CST);
+
+        // Either the loading of an image sees this reader, or the reader sees
+        // that the view has been replaced meanwhile and tries again.
+        if (__atomic_load_n(&store.current, __ATOMIC_SEQ_CST) == current)
+        {
+            if (!view->isLoaded)
+            {
+                config_store_release(view);
+                return NULL;
+            }
+            return view;
+        }
+
+        __atomic_sub_fetch(&view->numReaders, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+config_store_release(
+    const config_store_view_t* view)
+{
+    Debug_ASSERT((view == &store.views[0]) || (view == &store.views[1]));
+
+    config_store_view_t* self = &store.views[view - store.views];
+    __atomic_sub_fetch(&self->numReaders, 1, __ATOMIC_SEQ_CST);
+}
+
+//------------------------------------------------------------------------------
+bool
+config_store_find(
+    const config_store_view_t*  view,
+    const char*                 domain,
+    const char*                 name,
+    config_store_value_t*       value)
+{
+    if (view->isImage)
+    {
+        const config_image_entry_t* entry =
+            config_image_find(&view->image, domain, name);
+        if (NULL == entry)
+        {
+            return false;
+        }
+        value->size  = entry->size;
+        value->value = config_image_getValue(&view->image, entry);
+        return true;
+    }
+
+    for (size_t i = 0; i < store.numEntries; i++)
+    {
+        const config_store_entry_t* entry = &store.entries[i];
+        if ((0 == strncmp(entry->domain, domain, sizeof(entry->domain)))
+            && (0 == strncmp(entry->name, name, sizeof(entry->name))))
+        {
+            value->size  = entry->size;
+            value->value = entry->value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void
+config_store_forEachInDomain(
+    const config_store_view_t*  view,
+    const char*                 domain,
+    config_store_visitor_t      visit,
+    void*                       ctx)
+{
+    if (view->isImage)
+    {
+        for (uint32_t i = 0; i < view->image.header->numEntries; i++)
+        {
+            const config_image_entry_t* entry = &view->image.entries[i];
+            if (0 != strncmp(entry->domain, domain, sizeof(entry->domain)))
+            {
+                continue;
+            }
+
+            // the names in the image need not be terminated
+            char name[CONFIG_IMAGE_NAME_SIZE + 1] = {0};
+            memcpy(name, entry->parameter, CONFIG_IMAGE_NAME_SIZE);
+            const config_store_value_t value =
+            {
+                .size  = entry->size,
+                .value = config_image_getValue(&view->image, entry)
+            };
+            visit(name, &value, ctx);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < store.numEntries; i++)
+    {
+        const config_store_entry_t* entry = &store.entries[i];
+        if (0 != strncmp(entry->domain, domain, sizeof(entry->domain)))
+        {
+            continue;
+        }
+
+        const config_store_value_t value =
+        {
+            .size  = entry->size,
+            .value = entry->value
+        };
+        visit(entry->name, &value, ctx);
+    }
+}
@@ -0,0 +1,96 @@
+/*
+ * Read-only copy of all configuration parameters in RAM
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_ConfigService.h"
+
+#include "config_image.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONFIG_STORE_MAX_PARAMETERS 64
+#define CONFIG_STORE_ARENA_SIZE     (16 * 1024)
+
+typedef struct
+{
+    char        domain[OS_CONFIG_LIB_DOMAIN_NAME_SIZE];
+    char        name[OS_CONFIG_LIB_PARAMETER_NAME_SIZE];
+    uint32_t    type;
+    uint32_t    size;
+    const void* value;
+} config_store_entry_t;
+
+typedef struct
+{
+    uint32_t    size;
+    const void* value;
+} config_store_value_t;
+
+// The configuration readers use. It is not modified while a reader holds it,
+// a new image goes into another view.
+typedef struct
+{
+    bool            isLoaded;
+    bool            isImage;
+    config_image_t  image;
+    uint32_t        numReaders;
+} config_store_view_t;
+
+typedef void (*config_store_visitor_t)(
+    const char*                 name,
+    const config_store_value_t* value,
+    void*                       ctx);
+
+
+//------------------------------------------------------------------------------
+// Copy all parameters of all domains. This must be done before the store is
+// read, the parameters are not modified afterwards.
+OS_Error_t
+config_store_load(
+    OS_ConfigServiceHandle_t handle);
+
+// Use a configuration image instead, see config_image.h. It is not copied, so
+// it must stay in memory until the next image has been loaded and
+// config_store_isPreviousInUse() returns false. If the image is invalid, the
+// store is not changed. Only one thread may load images.
+OS_Error_t
+config_store_loadImage(
+    const void* image,
+    size_t      len);
+
+// Check if a reader still holds the view that the last image has replaced.
+bool
+config_store_isPreviousInUse(void);
+
+// Get the current view, readers never wait for each other or for the loading
+// of an image. Returns NULL if nothing has been loaded.
+const config_store_view_t*
+config_store_acquire(void);
+
+void
+config_store_release(
+    const config_store_view_t* view);
+
+bool
+config_store_find(
+    const config_store_view_t*  view,
+    const char*                 domain,
+    const char*                 name,
+    config_store_value_t*       value);
+
+void
+config_store_forEachInDomain(
+    const config_store_view_t*  view,
+    const char*                 domain,
+    config_store_visitor_t      visit,
+    void*                       ctx);
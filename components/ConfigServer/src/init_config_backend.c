@@ -6,10 +6,12 @@
  * For commercial licensing, contact: info.cyber@hensoldt.net
  */
 
+#include <stdbool.h>
 #include <string.h>
 #include <camkes.h>
 
 #include "init_config_backend.h"
+#include "system_config.h"
 
 
 /* Defines -------------------------------------------------------------------*/
@@ -18,6 +20,12 @@
 #define STRING_FILE "STRING.BIN"
 #define BLOB_FILE "BLOB.BIN"
 
+// upper bound of the header the library puts in front of the records of a
+// memory backend
+#define MEM_BACKEND_HEADER_SIZE 64
+#define MEM_BACKEND_ALIGNMENT   8
+#define MAX_RECORD_SIZE         1024
+
 
 /* Private types -------------------------------------------------------------*/
 
@@ -30,6 +38,26 @@ static OS_FileSystem_Config_t cfg =
         storage_port),
 };
 
+// parameter, domain, string and blob backend, in the order the config library
+// takes them
+enum
+{
+    BACKEND_PARAMETER,
+    BACKEND_DOMAIN,
+    BACKEND_STRING,
+    BACKEND_BLOB,
+    NUM_BACKENDS
+};
+
+static OS_ConfigServiceBackend_t fileBackends[NUM_BACKENDS];
+static OS_ConfigServiceBackend_t memBackends[NUM_BACKENDS];
+static bool isPreloaded = false;
+
+// all records of the files, so that lookups don't need the storage anymore
+static uint8_t arena[CONFIGSERVER_BACKEND_RAM_SIZE]
+__attribute__((aligned(MEM_BACKEND_ALIGNMENT)));
+static uint8_t record[MAX_RECORD_SIZE];
+
 static
 void initializeName(char* buf, size_t bufSize, char const* name)
 {
@@ -38,13 +66,13 @@ void initializeName(char* buf, size_t bufSize, char const* name)
 }
 
 static
-OS_Error_t initializeFileBackends(OS_ConfigServiceLib_t* configLib,
-                                  OS_FileSystem_Handle_t hFs)
+OS_Error_t initializeFileBackends(OS_FileSystem_Handle_t hFs)
 {
-    OS_ConfigServiceBackend_t parameterBackend;
-    OS_ConfigServiceBackend_t domainBackend;
-    OS_ConfigServiceBackend_t stringBackend;
-    OS_ConfigServiceBackend_t blobBackend;
+    OS_ConfigServiceBackend_t* parameterBackend =
+        &fileBackends[BACKEND_PARAMETER];
+    OS_ConfigServiceBackend_t* domainBackend = &fileBackends[BACKEND_DOMAIN];
+    OS_ConfigServiceBackend_t* stringBackend = &fileBackends[BACKEND_STRING];
+    OS_ConfigServiceBackend_t* blobBackend = &fileBackends[BACKEND_BLOB];
     OS_ConfigServiceBackend_FileName_t name;
 
     Debug_LOG_INFO("Initializing file backends...");
@@ -55,7 +83,7 @@ OS_Error_t initializeFileBackends(OS_ConfigServiceLib_t* configLib,
         OS_CONFIG_BACKEND_MAX_FILE_NAME_SIZE,
         DOMAIN_FILE);
     OS_Error_t err = OS_ConfigServiceBackend_initializeFileBackend(
-                         &domainBackend,
+                         domainBackend,
                          name,
                          hFs);
     Debug_LOG_DEBUG("Domain name: %s", name.buffer);
@@ -71,7 +99,7 @@ OS_Error_t initializeFileBackends(OS_ConfigServiceLib_t* configLib,
         OS_CONFIG_BACKEND_MAX_FILE_NAME_SIZE,
         PARAMETER_FILE);
     err = OS_ConfigServiceBackend_initializeFileBackend(
-              &parameterBackend,
+              parameterBackend,
               name,
               hFs);
     if (err != OS_SUCCESS)
@@ -87,7 +115,7 @@ OS_Error_t initializeFileBackends(OS_ConfigServiceLib_t* configLib,
         OS_CONFIG_BACKEND_MAX_FILE_NAME_SIZE,
         STRING_FILE);
     err = OS_ConfigServiceBackend_initializeFileBackend(
-              &stringBackend,
+              stringBackend,
               name,
               hFs);
     if (err != OS_SUCCESS)
@@ -103,7 +131,7 @@ OS_Error_t initializeFileBackends(OS_ConfigServiceLib_t* configLib,
         OS_CONFIG_BACKEND_MAX_FILE_NAME_SIZE,
         BLOB_FILE);
     err = OS_ConfigServiceBackend_initializeFileBackend(
-              &blobBackend,
+              blobBackend,
               name,
               hFs);
     if (err != OS_SUCCESS)
@@ -114,19 +142,99 @@ OS_Error_t initializeFileBackends(OS_ConfigServiceLib_t* configLib,
     }
     Debug_LOG_DEBUG("Blob backend initialized.");
 
-    err = OS_ConfigServiceLib_Init(
-              configLib,
-              &parameterBackend,
-              &domainBackend,
-              &stringBackend,
-              &blobBackend);
+    Debug_LOG_INFO("File backends initialized.");
+
+    return OS_SUCCESS;
+}
+
+static
+OS_Error_t useBackends(OS_ConfigServiceBackend_t const* backends)
+{
+    OS_Error_t err = OS_ConfigServiceLib_Init(
+                         OS_ConfigService_getInstance(),
+                         &backends[BACKEND_PARAMETER],
+                         &backends[BACKEND_DOMAIN],
+                         &backends[BACKEND_STRING],
+                         &backends[BACKEND_BLOB]);
     if (err != OS_SUCCESS)
     {
         Debug_LOG_ERROR("OS_ConfigServiceLib_Init() failed with: %d", err);
         return err;
     }
 
-    Debug_LOG_INFO("File backends initialized.");
+    return OS_SUCCESS;
+}
+
+// Copy all records of a file backend into a memory backend at the start of the
+// free part of the arena.
+static
+OS_Error_t copyToMemBackend(OS_ConfigServiceBackend_t const* fileBackend,
+                            OS_ConfigServiceBackend_t* memBackend,
+                            size_t* arenaUsed)
+{
+    const size_t numRecords =
+        OS_ConfigServiceBackend_getNumberOfRecords(fileBackend);
+    const size_t recordSize =
+        OS_ConfigServiceBackend_getSizeOfRecords(fileBackend);
+    if (recordSize > sizeof(record))
+    {
+        Debug_LOG_ERROR("record size %zu not supported", recordSize);
+        return OS_ERROR_NOT_SUPPORTED;
+    }
+
+    const size_t size = (MEM_BACKEND_HEADER_SIZE + numRecords * recordSize
+                         + MEM_BACKEND_ALIGNMENT - 1)
+                        & ~((size_t)MEM_BACKEND_ALIGNMENT - 1);
+    if (size > sizeof(arena) - *arenaUsed)
+    {
+        Debug_LOG_WARNING("%zu records of %zu bytes don't fit into the RAM "
+                          "backend", numRecords, recordSize);
+        return OS_ERROR_INSUFFICIENT_SPACE;
+    }
+
+    void* buf = &arena[*arenaUsed];
+    OS_Error_t err = OS_ConfigServiceBackend_createMemBackend(
+                         buf,
+                         size,
+                         numRecords,
+                         recordSize);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("OS_ConfigServiceBackend_createMemBackend() failed "
+                        "with: %d", err);
+        return err;
+    }
+
+    err = OS_ConfigServiceBackend_initializeMemBackend(memBackend, buf, size);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("OS_ConfigServiceBackend_initializeMemBackend() failed "
+                        "with: %d", err);
+        return err;
+    }
+
+    for (unsigned int i = 0; i < numRecords; i++)
+    {
+        err = OS_ConfigServiceBackend_readRecord(fileBackend, i, record,
+                                                 recordSize);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("OS_ConfigServiceBackend_readRecord() failed "
+                            "with: %d", err);
+            return err;
+        }
+
+        err = OS_ConfigServiceBackend_writeRecord(memBackend, i, record,
+                                                  recordSize);
+        if (err != OS_SUCCESS)
+        {
+            Debug_LOG_ERROR("OS_ConfigServiceBackend_writeRecord() failed "
+                            "with: %d", err);
+            return err;
+        }
+    }
+
+    *arenaUsed += size;
 
     return OS_SUCCESS;
 }
@@ -150,15 +258,56 @@ init_system_config_backend(void)
         return err;
     }
 
-    OS_ConfigServiceLib_t* configLib =
-        OS_ConfigService_getInstance();
-
-    err = initializeFileBackends(configLib, hFs);
+    err = initializeFileBackends(hFs);
     if (err != OS_SUCCESS)
     {
         Debug_LOG_ERROR("initializeFileBackends() failed with: %d", err);
         return err;
     }
 
+    return useBackends(fileBackends);
+}
+
+OS_Error_t
+preload_system_config_backend(size_t* size)
+{
+    size_t arenaUsed = 0;
+
+    for (size_t i = 0; i < NUM_BACKENDS; i++)
+    {
+        OS_Error_t err = copyToMemBackend(&fileBackends[i], &memBackends[i],
+                                          &arenaUsed);
+        if (err != OS_SUCCESS)
+        {
+            // the file backends stay in use
+            return err;
+        }
+    }
+
+    OS_Error_t err = useBackends(memBackends);
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    isPreloaded = true;
+    *size = arenaUsed;
+
+    Debug_LOG_INFO("RAM backends initialized.");
+
     return OS_SUCCESS;
 }
+
+OS_Error_t
+select_system_config_backend(config_backend_type_t type)
+{
+    switch (type)
+    {
+    case CONFIG_BACKEND_FILE:
+        return useBackends(fileBackends);
+    case CONFIG_BACKEND_RAM:
+        return isPreloaded ? useBackends(memBackends) : OS_ERROR_INVALID_STATE;
+    default:
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+}
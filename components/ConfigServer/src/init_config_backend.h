@@ -12,5 +12,22 @@
 
 #include "OS_ConfigService.h"
 
+#include <stddef.h>
 
+
+typedef enum
+{
+    CONFIG_BACKEND_FILE,
+    CONFIG_BACKEND_RAM
+} config_backend_type_t;
+
+// Mount the file system and let the config library use the files.
 OS_Error_t init_system_config_backend();
+
+// Load all records of the files into RAM and let the config library use them
+// from there. If they don't fit, the files stay in use. The size used in RAM
+// is returned.
+OS_Error_t preload_system_config_backend(size_t* size);
+
+// Switch between the files and the RAM copy, for the benchmark.
+OS_Error_t select_system_config_backend(config_backend_type_t type);
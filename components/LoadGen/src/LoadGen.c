@@ -0,0 +1,521 @@
+/**
+ * Load generator component that sends synthetic readings to the CloudConnector
+ * to measure the throughput of the whole chain to the broker.
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "lib_debug/Debug.h"
+
+#include "OS_ConfigService.h"
+#include "OS_Dataport.h"
+
+#include "helper_func.h"
+#include "msg_ring.h"
+#include "sensor_record.h"
+
+#include "TimeServer.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <camkes.h>
+
+/* Defines -------------------------------------------------------------------*/
+// the following defines are the parameter names that need to match the settings
+// in the configuration xml file
+#define DOMAIN_LOADGEN          "Domain-LoadGen"
+#define TOPIC_NAME              "Topic"
+#define NUM_TOPICS_NAME         "Topics"
+#define RATE_NAME               "Rate_Hz"
+#define BURST_SIZE_NAME         "BurstSize"
+#define PAYLOAD_MIN_NAME        "PayloadMin"
+#define PAYLOAD_MAX_NAME        "PayloadMax"
+#define PAYLOAD_DIST_NAME       "PayloadDist"
+
+// The readings are sent with one topic id, the instance number spreads them
+// over up to LOADGEN_MAX_TOPICS topics "<topic>/<instance>".
+#define LOADGEN_TOPIC_ID        0
+#define LOADGEN_MAX_TOPICS      100000
+#define LOADGEN_MAX_RATE_HZ     10000
+
+// the payload and the topic must fit into the send buffer of the MQTT client
+#define LOADGEN_MAX_PAYLOAD     768
+
+// the tick is not shorter than this, a higher rate is sent in larger bursts
+#define LOADGEN_MIN_TICK_US     1000
+
+// Sent readings are tracked until the CloudConnector releases them, which is
+// after they have been published. The ring never holds more frames than this.
+#define LOADGEN_TRACK_SIZE      256
+
+// the statistics are logged and reset with this period
+#define STATS_PERIOD_MS         10000
+
+typedef enum
+{
+    PAYLOAD_DIST_FIXED,
+    PAYLOAD_DIST_UNIFORM,
+    PAYLOAD_DIST_EXP,
+} payload_dist_t;
+
+OS_ConfigServiceHandle_t hConfig;
+
+static const if_ConfigBatch_t configBatch =
+    IF_CONFIG_BATCH_ASSIGN(
+        configBatch_rpc,
+        configServer_port);
+
+// parameters that are fetched with one batched call at startup
+static const char* const configParameterNames[] =
+{
+    TOPIC_NAME,
+    NUM_TOPICS_NAME,
+    RATE_NAME,
+    BURST_SIZE_NAME,
+    PAYLOAD_MIN_NAME,
+    PAYLOAD_MAX_NAME,
+    PAYLOAD_DIST_NAME,
+};
+
+static const if_OS_Timer_t timer =
+    IF_OS_TIMER_ASSIGN(
+        timeServer_rpc,
+        timeServer_notify);
+
+static msg_ring_t cloudConnectorRing;
+
+static struct
+{
+    char            topic[32];
+    uint32_t        numTopics;
+    uint32_t        rate_hz;
+    uint32_t        burstSize;
+    uint32_t        payloadMin;
+    uint32_t        payloadMax;
+    payload_dist_t  payloadDist;
+} cfg;
+
+// the readings due since the start are sent, those that don't fit into the
+// ring are dropped. So the offered load does not depend on the CloudConnector.
+static struct
+{
+    uint64_t    start_ms;
+    uint64_t    numDue;
+    uint32_t    seq;
+    uint32_t    instance;
+} load;
+
+// readings in flight, oldest first
+static struct
+{
+    struct
+    {
+        uint32_t    ticket;
+        uint64_t    sent_ms;
+    } entries[LOADGEN_TRACK_SIZE];
+    size_t          first;
+    size_t          count;
+} inFlight;
+
+static struct
+{
+    uint64_t    start_ms;
+    uint32_t    sent;
+    uint32_t    dropped;
+    uint32_t    acked;
+    uint32_t    untracked;
+    uint64_t    latencySum_ms;
+    uint64_t    latencyMin_ms;
+    uint64_t    latencyMax_ms;
+} stats;
+
+// the record and the largest payload
+static uint8_t frame[sizeof(sensor_record_t) + LOADGEN_MAX_PAYLOAD];
+static char payload[LOADGEN_MAX_PAYLOAD];
+
+static OS_Error_t
+initializeLoadGen(void)
+{
+    static OS_ConfigService_ClientCtx_t ctx =
+    {
+        .dataport = OS_DATAPORT_ASSIGN(configServer_port)
+    };
+    OS_Error_t err = OS_ConfigService_createHandleRemote(
+                         &ctx,
+                         &hConfig);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("OS_ConfigService_createHandleRemote() failed with :%d", err);
+        return err;
+    }
+
+    // parameters are read from the snapshot of the ConfigServer, if there is one
+    helper_func_attachConfigSnapshot(
+        (OS_Dataport_t) OS_DATAPORT_ASSIGN(configSnapshot_port));
+
+    // without a snapshot, the profile is fetched in one call, the parameters
+    // are looked up one by one if this fails
+    err = helper_func_prefetchConfigParameters(
+              &configBatch,
+              DOMAIN_LOADGEN,
+              configParameterNames,
+              sizeof(configParameterNames) / sizeof(configParameterNames[0]));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("helper_func_prefetchConfigParameters() failed with :%d",
+                          err);
+    }
+
+    OS_Dataport_t port = OS_DATAPORT_ASSIGN(cloudConnector_port);
+    err = msg_ring_init(&cloudConnectorRing,
+                        OS_Dataport_getBuf(port),
+                        OS_Dataport_getSize(port));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("msg_ring_init() failed with :%d", err);
+        return err;
+    }
+
+    return OS_SUCCESS;
+}
+
+static OS_Error_t
+getParameter(
+    const char* name,
+    void*       value,
+    size_t      size)
+{
+    OS_Error_t err = helper_func_getConfigParameter(&hConfig,
+                                                    DOMAIN_LOADGEN,
+                                                    name,
+                                                    value,
+                                                    size);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
+                        name, err);
+    }
+
+    return err;
+}
+
+static OS_Error_t
+initializeProfile(void)
+{
+    char dist[16] = { 0 };
+
+    OS_Error_t err;
+    if (((err = getParameter(TOPIC_NAME, cfg.topic,
+                             sizeof(cfg.topic) - 1)) != OS_SUCCESS)
+        || ((err = getParameter(NUM_TOPICS_NAME, &cfg.numTopics,
+                                sizeof(cfg.numTopics))) != OS_SUCCESS)
+        || ((err = getParameter(RATE_NAME, &cfg.rate_hz,
+                                sizeof(cfg.rate_hz))) != OS_SUCCESS)
+        || ((err = getParameter(BURST_SIZE_NAME, &cfg.burstSize,
+                                sizeof(cfg.burstSize))) != OS_SUCCESS)
+        || ((err = getParameter(PAYLOAD_MIN_NAME, &cfg.payloadMin,
+                                sizeof(cfg.payloadMin))) != OS_SUCCESS)
+        || ((err = getParameter(PAYLOAD_MAX_NAME, &cfg.payloadMax,
+                                sizeof(cfg.payloadMax))) != OS_SUCCESS)
+        || ((err = getParameter(PAYLOAD_DIST_NAME, dist,
+                                sizeof(dist) - 1)) != OS_SUCCESS))
+    {
+        return err;
+    }
+
+    if (0 == strcmp(dist, "fixed"))
+    {
+        cfg.payloadDist = PAYLOAD_DIST_FIXED;
+    }
+    else if (0 == strcmp(dist, "uniform"))
+    {
+        cfg.payloadDist = PAYLOAD_DIST_UNIFORM;
+    }
+    else if (0 == strcmp(dist, "exp"))
+    {
+        cfg.payloadDist = PAYLOAD_DIST_EXP;
+    }
+    else
+    {
+        Debug_LOG_ERROR("unknown payload distribution '%s'", dist);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if ((0 == cfg.numTopics) || (cfg.numTopics > LOADGEN_MAX_TOPICS)
+        || (0 == cfg.rate_hz) || (cfg.rate_hz > LOADGEN_MAX_RATE_HZ)
+        || (0 == cfg.burstSize) || (cfg.burstSize > cfg.rate_hz)
+        || (0 == cfg.payloadMin) || (cfg.payloadMin > cfg.payloadMax)
+        || (cfg.payloadMax > LOADGEN_MAX_PAYLOAD))
+    {
+        Debug_LOG_ERROR("invalid load profile");
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    // the payload is a repeating pattern, it is not parsed as a number
+    for (size_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = 'a' + (i % 26);
+    }
+
+    Debug_LOG_INFO("Load of %u readings/s in bursts of %u, %u topics '%s/<n>', "
+                   "%s payloads of %u to %u bytes", cfg.rate_hz, cfg.burstSize,
+                   cfg.numTopics, cfg.topic, dist, cfg.payloadMin,
+                   cfg.payloadMax);
+
+    return OS_SUCCESS;
+}
+
+static OS_Error_t
+startTick(void)
+{
+    // the readings of a burst are sent in the same tick
+    uint64_t period_us = (1000000ULL * cfg.burstSize) / cfg.rate_hz;
+    if (period_us < LOADGEN_MIN_TICK_US)
+    {
+        period_us = LOADGEN_MIN_TICK_US;
+    }
+
+    // set up a tick with the local timer ID 1. The local timer ID 0 is used for
+    // the sleep() function of the TimeServer
+    int ret = timeServer_rpc_periodic(1, period_us * NS_IN_US);
+    if (0 != ret)
+    {
+        Debug_LOG_ERROR("timeServer_rpc_periodic() failed, code %d", ret);
+        return OS_ERROR_GENERIC;
+    }
+
+    return OS_SUCCESS;
+}
+
+static uint64_t
+getTime(void)
+{
+    uint64_t now_ms = 0;
+    OS_Error_t err = TimeServer_getTime(&timer, TimeServer_PRECISION_MSEC,
+                                        &now_ms);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("TimeServer_getTime() failed with :%d", err);
+    }
+
+    return now_ms;
+}
+
+static size_t
+getPayloadSize(void)
+{
+    static uint32_t rng = 1;
+
+    const uint32_t range = cfg.payloadMax - cfg.payloadMin;
+    rng = rng * 1103515245 + 12345;
+    const uint32_t r = (rng >> 8) & 0xffff;
+
+    switch (cfg.payloadDist)
+    {
+    case PAYLOAD_DIST_UNIFORM:
+        return cfg.payloadMin + (size_t)((uint64_t)r * (range + 1) / 0x10000);
+    case PAYLOAD_DIST_EXP:
+    {
+        // mostly small payloads with a long tail, the mean is a quarter of
+        // the range above the minimum
+        double size = -log((r + 1) / 65537.0) * (range / 4.0);
+        return cfg.payloadMin + ((size < range) ? (size_t)size : range);
+    }
+    case PAYLOAD_DIST_FIXED:
+    default:
+        return cfg.payloadMin;
+    }
+}
+
+static void
+trackReading(
+    uint32_t ticket,
+    uint64_t now_ms)
+{
+    if (LOADGEN_TRACK_SIZE == inFlight.count)
+    {
+        stats.untracked++;
+        return;
+    }
+
+    size_t i = (inFlight.first + inFlight.count) % LOADGEN_TRACK_SIZE;
+    inFlight.entries[i].ticket  = ticket;
+    inFlight.entries[i].sent_ms = now_ms;
+    inFlight.count++;
+}
+
+// The CloudConnector releases the frames in order, so only the oldest reading
+// needs to be checked.
+static void
+checkAcks(
+    uint64_t now_ms)
+{
+    while ((inFlight.count > 0)
+           && msg_ring_isReleased(&cloudConnectorRing,
+                                  inFlight.entries[inFlight.first].ticket))
+    {
+        uint64_t latency_ms = now_ms - inFlight.entries[inFlight.first].sent_ms;
+        if ((0 == stats.acked) || (latency_ms < stats.latencyMin_ms))
+        {
+            stats.latencyMin_ms = latency_ms;
+        }
+        if (latency_ms > stats.latencyMax_ms)
+        {
+            stats.latencyMax_ms = latency_ms;
+        }
+        stats.latencySum_ms += latency_ms;
+        stats.acked++;
+
+        inFlight.first = (inFlight.first + 1) % LOADGEN_TRACK_SIZE;
+        inFlight.count--;
+    }
+}
+
+// Send all readings that are due. Returns the number of readings sent.
+static uint32_t
+sendDue(
+    uint64_t now_ms)
+{
+    const uint64_t numDue = ((now_ms - load.start_ms) * cfg.rate_hz) / 1000;
+    uint32_t numSent = 0;
+    bool isFull = false;
+
+    for (; load.numDue < numDue; load.numDue++)
+    {
+        sensor_record_t record =
+        {
+            .type          = SENSOR_RECORD_TYPE_TEXT,
+            .flags         = SENSOR_RECORD_FLAG_INSTANCE,
+            .topicId       = LOADGEN_TOPIC_ID,
+            .seq           = load.seq++,
+            .timestamp_ms  = now_ms,
+            .value.dataLen = getPayloadSize(),
+            .instance      = load.instance,
+        };
+        load.instance = (load.instance + 1) % cfg.numTopics;
+
+        // once the ring is full, the rest of the burst is dropped. The gap in
+        // the sequence numbers tells the CloudConnector about it.
+        size_t len;
+        uint32_t ticket;
+        if (isFull
+            || (sensor_record_write(frame, sizeof(frame), &record, payload,
+                                    &len) != OS_SUCCESS)
+            || (msg_ring_enqueue(&cloudConnectorRing, frame, len,
+                                 &ticket) != OS_SUCCESS))
+        {
+            isFull = true;
+            stats.dropped++;
+            continue;
+        }
+
+        trackReading(ticket, now_ms);
+        stats.sent++;
+        numSent++;
+    }
+
+    return numSent;
+}
+
+static void
+logStats(
+    uint64_t now_ms)
+{
+    const uint64_t elapsed_ms = now_ms - stats.start_ms;
+    if (elapsed_ms < STATS_PERIOD_MS)
+    {
+        return;
+    }
+
+    msg_ring_status_t status;
+    msg_ring_getStatus(&cloudConnectorRing, &status);
+
+    Debug_LOG_INFO("%u sent, %u dropped, %u acked (%" PRIu64 "/s), latency "
+                   "min %" PRIu64 " ms, mean %" PRIu64 " ms, max %" PRIu64
+                   " ms, %u untracked, ring %u frames, %u/%u bytes",
+                   stats.sent, stats.dropped, stats.acked,
+                   stats.acked * 1000ULL / elapsed_ms,
+                   stats.latencyMin_ms,
+                   (stats.acked > 0) ? (stats.latencySum_ms / stats.acked) : 0,
+                   stats.latencyMax_ms, stats.untracked, status.depth,
+                   status.fill, status.capacity);
+
+    memset(&stats, 0, sizeof(stats));
+    stats.start_ms = now_ms;
+}
+
+
+int run()
+{
+    OS_Error_t ret = initializeLoadGen();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("initializeLoadGen() failed with:%d", ret);
+        return ret;
+    }
+
+    Debug_LOG_INFO("Starting LoadGen...");
+
+    ret = initializeProfile();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("initializeProfile() failed with:%d", ret);
+        return ret;
+    }
+
+    ret = startTick();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("startTick() failed with:%d", ret);
+        return ret;
+    }
+
+    // the topic name is sent once, the readings refer to it by its id
+    size_t len;
+    sensor_record_t record =
+    {
+        .type          = SENSOR_RECORD_TYPE_TOPIC,
+        .topicId       = LOADGEN_TOPIC_ID,
+        .value.dataLen = strlen(cfg.topic),
+    };
+    ret = sensor_record_write(frame, sizeof(frame), &record, cfg.topic, &len);
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("sensor_record_write() failed with :%d", ret);
+        return ret;
+    }
+
+    while ((ret = msg_ring_enqueue(&cloudConnectorRing, frame, len, NULL))
+           != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("msg_ring_enqueue() for topic failed with :%d", ret);
+        timeServer_notify_wait();
+    }
+    cloudConnector_notify_emit();
+
+    load.start_ms  = getTime();
+    stats.start_ms = load.start_ms;
+
+    for (;;)
+    {
+        timeServer_notify_wait();
+
+        uint64_t now_ms = getTime();
+        checkAcks(now_ms);
+
+        // the CloudConnector is notified once per burst
+        if (sendDue(now_ms) > 0)
+        {
+            cloudConnector_notify_emit();
+        }
+
+        logStats(now_ms);
+    }
+
+    return 0;
+}
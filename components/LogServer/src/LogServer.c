@@ -32,6 +32,7 @@
 #define DATABUFFER_SERVER_03    (void *)sensor_port
 #define DATABUFFER_SERVER_04    (void *)nwDriver_port
 #define DATABUFFER_SERVER_05    (void *)nwStack_port
+#define DATABUFFER_SERVER_06    (void *)sensorHub_port
 
 // log server id
 #define LOG_SERVER_ID               0
@@ -42,16 +43,18 @@
 #define CLIENT_SENSORTEMP_ID        30
 #define CLIENT_NWDRIVER_ID          40
 #define CLIENT_NWSTACK_ID           50
+#define CLIENT_SENSORHUB_ID         60
 
 #define PARTITION_ID                1
 
 uint32_t API_LOG_SERVER_GET_SENDER_ID(void);
 
 static OS_LoggerFilter_Handle_t filter_configSrv,
-       filter_cloudCon, filter_sensorTemp, filter_nwDriver, filter_nwStack;
+       filter_cloudCon, filter_sensorTemp, filter_nwDriver, filter_nwStack,
+       filter_sensorHub;
 static OS_LoggerConsumer_Handle_t log_consumer_configSrv,
        log_consumer_cloudCon, log_consumer_sensorTemp,
-       log_consumer_nwDriver, log_consumer_nwStack;
+       log_consumer_nwDriver, log_consumer_nwStack, log_consumer_sensorHub;
 static OS_LoggerConsumerCallback_t log_consumer_callback;
 static OS_LoggerSubject_Handle_t subject;
 static OS_LoggerOutput_Handle_t console;
@@ -120,6 +123,7 @@ void pre_init(void)
     OS_LoggerFilter_ctor(&filter_sensorTemp,     Debug_LOG_LEVEL_INFO);
     OS_LoggerFilter_ctor(&filter_nwDriver,       Debug_LOG_LEVEL_INFO);
     OS_LoggerFilter_ctor(&filter_nwStack,        Debug_LOG_LEVEL_INFO);
+    OS_LoggerFilter_ctor(&filter_sensorHub,      Debug_LOG_LEVEL_INFO);
     // Emitter configuration
     OS_LoggerFilter_ctor(&filter_log_server,     Debug_LOG_LEVEL_INFO);
 
@@ -145,6 +149,9 @@ void pre_init(void)
     OS_LoggerConsumer_ctor(&log_consumer_nwStack,        DATABUFFER_SERVER_05,
                            &filter_nwStack,        &log_consumer_callback, &subject, NULL,
                            CLIENT_NWSTACK_ID, "NWSTACK");
+    OS_LoggerConsumer_ctor(&log_consumer_sensorHub,      DATABUFFER_SERVER_06,
+                           &filter_sensorHub,      &log_consumer_callback, &subject, NULL,
+                           CLIENT_SENSORHUB_ID, "SENSOR-HUB");
 
     // Emitter configuration
     OS_LoggerConsumer_ctor(&log_consumer_log_server, buf_log_server,
@@ -163,6 +170,7 @@ void pre_init(void)
     OS_LoggerConsumerChain_append(&log_consumer_sensorTemp);
     OS_LoggerConsumerChain_append(&log_consumer_nwDriver);
     OS_LoggerConsumerChain_append(&log_consumer_nwStack);
+    OS_LoggerConsumerChain_append(&log_consumer_sensorHub);
     // Emitter configuration
     OS_LoggerConsumerChain_append(&log_consumer_log_server);
 }
@@ -31,6 +31,11 @@
 static const if_NetworkStack_PicoTcp_Config_t networkStackConfig =
     if_NetworkStack_PicoTcp_Config_ASSIGN(networkStack_PicoTcp_Config);
 
+static const if_ConfigBatch_t configBatch =
+    IF_CONFIG_BATCH_ASSIGN(
+        configBatch_rpc,
+        configServer_port);
+
 //------------------------------------------------------------------------------
 static
 OS_Error_t
@@ -59,6 +64,30 @@ read_ip_from_config_server(
         return ret;
     }
 
+    // parameters are read from the snapshot of the ConfigServer, if there is one
+    helper_func_attachConfigSnapshot(
+        (OS_Dataport_t) OS_DATAPORT_ASSIGN(configSnapshot_port));
+
+    // The stack configuration is needed early at boot, when the snapshot may
+    // not be there yet. Then it is fetched in one call, which the ConfigServer
+    // serves in a thread of its own.
+    const char* const paramNames[] =
+    {
+        devAddrParamName,
+        gatewayAddrParamName,
+        subnetMaskParamName
+    };
+    ret = helper_func_prefetchConfigParameters(
+              &configBatch,
+              DOMAIN_NWSTACK,
+              paramNames,
+              sizeof(paramNames) / sizeof(paramNames[0]));
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("helper_func_prefetchConfigParameters() failed "
+                          "with :%d", ret);
+    }
+
     // Get the needed param values one by one from config server, using the
     // helper library wrapping around the ConfigServer API.
     ret = helper_func_getConfigParameter(&hConfig,
@@ -1,5 +1,5 @@
 /**
- * Sensor component that cyclically sends a MQTT message to the CloudConnector.
+ * Sensor component that cyclically sends a reading to the CloudConnector.
  *
  * Copyright (C) 2020-2024, HENSOLDT Cyber GmbH
  * 
@@ -11,30 +11,112 @@
 #include "lib_debug/Debug.h"
 
 #include "OS_ConfigService.h"
+#include "OS_Dataport.h"
 
+#include "config_params.h"
 #include "helper_func.h"
+#include "msg_ring.h"
+#include "sensor_record.h"
 
-#include "MQTTPacket.h"
+#include "TimeServer.h"
 
+#include <inttypes.h>
 #include <string.h>
 #include <camkes.h>
 #include "time.h"
 
 /* Defines -------------------------------------------------------------------*/
-// the following defines are the parameter names that need to match the settings
-// in the configuration xml file. These will be passed to the configServer
-// component to retrieve the settings for the specified parameter
-#define DOMAIN_SENSOR           "Domain-Sensor"
-#define MQTT_PAYLOAD_NAME       "MQTT_Payload" // _NAME defines are stored together with the values in the config file
-#define MQTT_TOPIC_NAME         "MQTT_Topic"
+// arbitrary max expected lengths
+#define MQTT_PAYLOAD_SIZE       128
+#define MQTT_TOPIC_SIZE         128
+
+// The parameter sizes in "config_params.h" are generated from the configuration
+// xml file. Payload and topic are strings, so their terminating zero must fit
+// as well.
+#if (CONFIG_PARAM_SENSOR_MQTT_PAYLOAD_MAX_SIZE >= MQTT_PAYLOAD_SIZE)
+#error "MQTT_Payload does not fit into payload"
+#endif
+#if (CONFIG_PARAM_SENSOR_MQTT_TOPIC_MAX_SIZE >= MQTT_TOPIC_SIZE)
+#error "MQTT_Topic does not fit into topic"
+#endif
 
 // send a new message to the cloudConnector every five seconds
 #define SEC_TO_SLEEP   5
 
+// the Sensor has a single topic
+#define SENSOR_TOPIC_ID 0
+
+// In sampling mode, the samples are kept in a local ring until they have been
+// sent in a batch. If the CloudConnector does not keep up, the oldest samples
+// are overwritten.
+#define SAMPLE_RATE_MAX_HZ      1000
+#define SAMPLE_RING_SIZE        256
+#define SAMPLE_BATCH_MAX        64
+
+// The period is adapted to the backpressure of the CloudConnector at most once
+// per drain rate period. Above the high fill level of the ring the period is
+// doubled, below the low level it is shortened by an eighth.
+#define ADAPT_INTERVAL_MS       MSG_RING_RATE_PERIOD_MS
+#define ADAPT_FILL_HIGH_PERCENT 50
+#define ADAPT_FILL_LOW_PERCENT  12
+
 OS_ConfigServiceHandle_t hConfig;
 
-static unsigned char payload[128]; // arbitrary max expected length
-static char topic[128];
+static const if_ConfigBatch_t configBatch =
+    IF_CONFIG_BATCH_ASSIGN(
+        configBatch_rpc,
+        configServer_port);
+
+// parameters that are fetched with one batched call at startup
+static const char* const configParameterNames[] =
+{
+    CONFIG_PARAM_SENSOR_MQTT_PAYLOAD_NAME,
+    CONFIG_PARAM_SENSOR_MQTT_TOPIC_NAME,
+    CONFIG_PARAM_SENSOR_SAMPLERATE_HZ_NAME,
+    CONFIG_PARAM_SENSOR_BATCHSIZE_NAME,
+    CONFIG_PARAM_SENSOR_FLUSHDEADLINE_MS_NAME,
+    CONFIG_PARAM_SENSOR_SAMPLEPERIODMIN_MS_NAME,
+    CONFIG_PARAM_SENSOR_SAMPLEPERIODMAX_MS_NAME,
+};
+
+static const if_OS_Timer_t timer =
+    IF_OS_TIMER_ASSIGN(
+        timeServer_rpc,
+        timeServer_notify);
+
+static msg_ring_t cloudConnectorRing;
+
+static unsigned char payload[MQTT_PAYLOAD_SIZE];
+static char topic[MQTT_TOPIC_SIZE];
+
+// sampling mode, a rate of 0 disables it
+static uint32_t sampleRate_hz;
+static uint32_t batchSize;
+static uint32_t flushDeadline_ms;
+
+// period of the tick, it is adapted within the bounds if they are configured
+typedef struct
+{
+    bool        isAdaptive;
+    uint64_t    period_us;
+    uint64_t    periodMin_us;
+    uint64_t    periodMax_us;
+    uint64_t    lastAdapt_ms;
+} tick_t;
+
+static tick_t tick;
+
+static struct
+{
+    sensor_record_sample_t  samples[SAMPLE_RING_SIZE];
+    size_t                  first;
+    size_t                  count;
+    uint32_t                firstSeq; // sequence number of the oldest sample
+} sampleRing;
+
+// the record and the data of the largest message
+static uint8_t frame[sizeof(sensor_record_t)
+                     + (SAMPLE_BATCH_MAX * sizeof(sensor_record_sample_t))];
 
 static OS_Error_t
 initializeSensor(void)
@@ -52,24 +134,437 @@ initializeSensor(void)
         return err;
     }
 
+    // parameters are read from the snapshot of the ConfigServer, if there is one
+    helper_func_attachConfigSnapshot(
+        (OS_Dataport_t) OS_DATAPORT_ASSIGN(configSnapshot_port));
+
+    // If the ConfigServer has not published the snapshot yet, the parameters
+    // are fetched in one call. The ConfigServer serves it in a thread of its
+    // own, the other clients that start up meanwhile don't wait for it. The
+    // parameters are looked up one by one if this fails.
+    err = helper_func_prefetchConfigParameters(
+              &configBatch,
+              CONFIG_DOMAIN_SENSOR,
+              configParameterNames,
+              sizeof(configParameterNames) / sizeof(configParameterNames[0]));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("helper_func_prefetchConfigParameters() failed with :%d",
+                          err);
+    }
+
+    OS_Dataport_t port = OS_DATAPORT_ASSIGN(cloudConnector_port);
+    err = msg_ring_init(&cloudConnectorRing,
+                        OS_Dataport_getBuf(port),
+                        OS_Dataport_getSize(port));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("msg_ring_init() failed with :%d", err);
+        return err;
+    }
+
+    return OS_SUCCESS;
+}
+
+static OS_Error_t
+CloudConnector_write(const void* msg, size_t len, uint32_t* ticket)
+{
+    // the message is enqueued without waiting for the CloudConnector, which
+    // drains all pending messages when it gets notified. The ticket tells
+    // later if the CloudConnector is done with it.
+    OS_Error_t err = msg_ring_enqueue(&cloudConnectorRing, msg, len, ticket);
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    cloudConnector_notify_emit();
+    return OS_SUCCESS;
+}
+
+
+static OS_Error_t
+initializeSampling(void)
+{
+    // the sampling mode is optional, without it a reading is sent every
+    // SEC_TO_SLEEP seconds
+    OS_Error_t err = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSOR_SAMPLERATE_HZ,
+              &sampleRate_hz,
+              sizeof(sampleRate_hz));
+    if (err == OS_ERROR_CONFIG_PARAMETER_NOT_FOUND)
+    {
+        sampleRate_hz = 0;
+    }
+    else if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSOR_SAMPLERATE_HZ_NAME, err);
+        return err;
+    }
+
+    if (0 == sampleRate_hz)
+    {
+        Debug_LOG_INFO("Sampling mode disabled");
+        return OS_SUCCESS;
+    }
+
+    err = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSOR_BATCHSIZE,
+              &batchSize,
+              sizeof(batchSize));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSOR_BATCHSIZE_NAME, err);
+        return err;
+    }
+
+    err = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSOR_FLUSHDEADLINE_MS,
+              &flushDeadline_ms,
+              sizeof(flushDeadline_ms));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSOR_FLUSHDEADLINE_MS_NAME, err);
+        return err;
+    }
+
+    if ((sampleRate_hz > SAMPLE_RATE_MAX_HZ) || (0 == batchSize)
+        || (batchSize > SAMPLE_BATCH_MAX))
+    {
+        Debug_LOG_ERROR("invalid sampling mode: %u Hz, batches of %u samples",
+                        sampleRate_hz, batchSize);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    Debug_LOG_INFO("Sampling at %u Hz, batches of %u samples or every %u ms",
+                   sampleRate_hz, batchSize, flushDeadline_ms);
+
+    return OS_SUCCESS;
+}
+
+static OS_Error_t
+initializeTick(void)
+{
+    tick.isAdaptive = false;
+    tick.period_us  = (sampleRate_hz > 0) ? (1000000 / sampleRate_hz)
+                      : (1000000ULL * SEC_TO_SLEEP);
+
+    // the adaptation is optional, without it the period is fixed
+    uint32_t periodMin_ms;
+    uint32_t periodMax_ms;
+    OS_Error_t err = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSOR_SAMPLEPERIODMIN_MS,
+              &periodMin_ms,
+              sizeof(periodMin_ms));
+    if (err == OS_ERROR_CONFIG_PARAMETER_NOT_FOUND)
+    {
+        Debug_LOG_INFO("Fixed period of %" PRIu64 " us", tick.period_us);
+        return OS_SUCCESS;
+    }
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSOR_SAMPLEPERIODMIN_MS_NAME, err);
+        return err;
+    }
+
+    err = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSOR_SAMPLEPERIODMAX_MS,
+              &periodMax_ms,
+              sizeof(periodMax_ms));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSOR_SAMPLEPERIODMAX_MS_NAME, err);
+        return err;
+    }
+
+    if ((0 == periodMin_ms) || (periodMin_ms > periodMax_ms))
+    {
+        Debug_LOG_ERROR("invalid period bounds %u ms to %u ms",
+                        periodMin_ms, periodMax_ms);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    tick.isAdaptive   = true;
+    tick.periodMin_us = 1000ULL * periodMin_ms;
+    tick.periodMax_us = 1000ULL * periodMax_ms;
+    if (tick.period_us < tick.periodMin_us)
+    {
+        tick.period_us = tick.periodMin_us;
+    }
+    else if (tick.period_us > tick.periodMax_us)
+    {
+        tick.period_us = tick.periodMax_us;
+    }
+
+    Debug_LOG_INFO("Adaptive period of %" PRIu64 " us, bounds %u ms to %u ms",
+                   tick.period_us, periodMin_ms, periodMax_ms);
+
+    return OS_SUCCESS;
+}
+
+static OS_Error_t
+startTick(void)
+{
     // set up a tick with the local timer ID 1. The local timer ID 0 is used for
     // the sleep() function of the TimeServer
-    int ret = timeServer_rpc_periodic(1, (NS_IN_S*SEC_TO_SLEEP));
+    int ret = timeServer_rpc_periodic(1, tick.period_us * NS_IN_US);
     if (0 != ret)
     {
         Debug_LOG_ERROR("timeServer_rpc_periodic() failed, code %d", ret);
-        return -1;
+        return OS_ERROR_GENERIC;
     }
 
     return OS_SUCCESS;
 }
 
+// Sample as dense as possible without overflowing the pipeline. The fill level
+// of the ring shows if the CloudConnector keeps up. If it does not release any
+// frames at all, eg because the connection to the broker is down, this is
+// taken as congestion as well.
+static void
+adaptTick(
+    uint64_t now_ms)
+{
+    if (!tick.isAdaptive || (now_ms - tick.lastAdapt_ms < ADAPT_INTERVAL_MS))
+    {
+        return;
+    }
+    tick.lastAdapt_ms = now_ms;
+
+    msg_ring_status_t status;
+    msg_ring_getStatus(&cloudConnectorRing, &status);
+    uint32_t fill_percent = (uint32_t)(100ULL * status.fill / status.capacity);
+
+    uint64_t period_us = tick.period_us;
+    if ((fill_percent >= ADAPT_FILL_HIGH_PERCENT)
+        || ((0 == status.drainRate_mHz) && (status.depth > 0)))
+    {
+        period_us *= 2;
+    }
+    else if (fill_percent <= ADAPT_FILL_LOW_PERCENT)
+    {
+        period_us -= period_us / 8;
+    }
+
+    if (period_us < tick.periodMin_us)
+    {
+        period_us = tick.periodMin_us;
+    }
+    else if (period_us > tick.periodMax_us)
+    {
+        period_us = tick.periodMax_us;
+    }
+
+    if (period_us == tick.period_us)
+    {
+        return;
+    }
+
+    Debug_LOG_DEBUG("period %" PRIu64 " us, ring %u%% full, %u frames, "
+                    "drain rate %u mHz", period_us, fill_percent,
+                    status.depth, status.drainRate_mHz);
+
+    int ret = timeServer_rpc_stop(1);
+    if (0 != ret)
+    {
+        Debug_LOG_WARNING("timeServer_rpc_stop() failed, code %d", ret);
+        return;
+    }
+
+    tick.period_us = period_us;
+    if (startTick() != OS_SUCCESS)
+    {
+        // keep going with a tick of the maximum period
+        tick.period_us = tick.periodMax_us;
+        startTick();
+    }
+}
+
+// Apply the parameters the ConfigServer has changed at runtime. A new payload
+// is sent with the next reading, new period bounds restart the tick. Nothing
+// else is restarted, readings that are queued are not lost.
+static void
+applyConfigChanges(void)
+{
+    if (!configChanged_notify_poll())
+    {
+        return;
+    }
+
+    if (helper_func_isConfigParameterChanged(CONFIG_PARAM_SENSOR_MQTT_PAYLOAD))
+    {
+        // the current payload is kept if the new one can't be read
+        unsigned char newPayload[MQTT_PAYLOAD_SIZE] = {0};
+        OS_Error_t err = helper_func_getConfigParameterById(
+                             &hConfig,
+                             CONFIG_PARAM_SENSOR_MQTT_PAYLOAD,
+                             newPayload,
+                             sizeof(newPayload) - 1);
+        if (err == OS_SUCCESS)
+        {
+            memcpy(payload, newPayload, sizeof(payload));
+            Debug_LOG_INFO("New MQTT Payload: %s", payload);
+        }
+        else
+        {
+            Debug_LOG_WARNING("helper_func_getConfigParameterById() for param %s failed with :%d",
+                              CONFIG_PARAM_SENSOR_MQTT_PAYLOAD_NAME, err);
+        }
+    }
+
+    if (helper_func_isConfigParameterChanged(
+            CONFIG_PARAM_SENSOR_SAMPLEPERIODMIN_MS)
+        || helper_func_isConfigParameterChanged(
+            CONFIG_PARAM_SENSOR_SAMPLEPERIODMAX_MS))
+    {
+        int ret = timeServer_rpc_stop(1);
+        if (0 != ret)
+        {
+            Debug_LOG_WARNING("timeServer_rpc_stop() failed, code %d", ret);
+            return;
+        }
+
+        // invalid bounds are ignored, the tick goes on as before
+        const tick_t previousTick = tick;
+        if (initializeTick() != OS_SUCCESS)
+        {
+            tick = previousTick;
+        }
+        if (startTick() != OS_SUCCESS)
+        {
+            tick.period_us = tick.isAdaptive ? tick.periodMax_us
+                             : previousTick.period_us;
+            startTick();
+        }
+    }
+}
+
+// The demo has no real sensor, the temperature wanders between 20 and 26 °C.
+static double
+readTemperature(void)
+{
+    static uint32_t rng = 1;
+    static double temperature = 23.0;
+
+    rng = rng * 1103515245 + 12345;
+    temperature += ((double)((rng >> 16) % 21) - 10.0) / 100.0;
+    if ((temperature < 20.0) || (temperature > 26.0))
+    {
+        temperature = 23.0;
+    }
+
+    return temperature;
+}
+
+// Returns the timestamp of the sample.
+static uint64_t
+acquireSample(void)
+{
+    if (SAMPLE_RING_SIZE == sampleRing.count)
+    {
+        // the CloudConnector does not keep up, drop the oldest sample. The
+        // gap in the sequence numbers tells the CloudConnector about it.
+        sampleRing.first = (sampleRing.first + 1) % SAMPLE_RING_SIZE;
+        sampleRing.firstSeq++;
+        sampleRing.count--;
+    }
+
+    sensor_record_sample_t* sample =
+        &sampleRing.samples[(sampleRing.first + sampleRing.count)
+                            % SAMPLE_RING_SIZE];
+    OS_Error_t err = TimeServer_getTime(&timer, TimeServer_PRECISION_MSEC,
+                                        &sample->timestamp_ms);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("TimeServer_getTime() failed with :%d", err);
+    }
+    sample->value = readTemperature();
+    sampleRing.count++;
+
+    return sample->timestamp_ms;
+}
+
+// Send the oldest samples in one batch. They stay in the local ring if the
+// CloudConnector ring is full.
 static OS_Error_t
-CloudConnector_write(unsigned char* msg, void* dataPort, size_t len)
+sendBatch(void)
 {
-    memcpy(dataPort, msg, len);
-    OS_Error_t err = cloudConnector_rpc_write();
-    return err;
+    static sensor_record_sample_t batch[SAMPLE_BATCH_MAX];
+
+    size_t n = (sampleRing.count < batchSize) ? sampleRing.count : batchSize;
+    for (size_t i = 0; i < n; i++)
+    {
+        batch[i] = sampleRing.samples[(sampleRing.first + i) % SAMPLE_RING_SIZE];
+    }
+
+    sensor_record_t record =
+    {
+        .type          = SENSOR_RECORD_TYPE_BATCH,
+        .topicId       = SENSOR_TOPIC_ID,
+        .seq           = sampleRing.firstSeq,
+        .timestamp_ms  = batch[0].timestamp_ms,
+        .value.dataLen = n * sizeof(batch[0]),
+    };
+    size_t len;
+    OS_Error_t err = sensor_record_write(frame, sizeof(frame), &record, batch,
+                                         &len);
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    err = CloudConnector_write(frame, len, NULL);
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    sampleRing.first     = (sampleRing.first + n) % SAMPLE_RING_SIZE;
+    sampleRing.count    -= n;
+    sampleRing.firstSeq += n;
+
+    return OS_SUCCESS;
+}
+
+// Acquire a sample on every tick. A batch is sent when it is full or when its
+// oldest sample has waited for the flush deadline.
+static void
+runSampling(void)
+{
+    for (;;)
+    {
+        applyConfigChanges();
+
+        uint64_t now_ms = acquireSample();
+        adaptTick(now_ms);
+
+        // a backlog is sent in several batches
+        while ((sampleRing.count >= batchSize)
+               || ((sampleRing.count > 0)
+                   && (now_ms - sampleRing.samples[sampleRing.first].timestamp_ms
+                       >= flushDeadline_ms)))
+        {
+            OS_Error_t err = sendBatch();
+            if (err != OS_SUCCESS)
+            {
+                Debug_LOG_WARNING("sendBatch() failed with :%d, %zu samples "
+                                  "pending", err, sampleRing.count);
+                break;
+            }
+        }
+
+        timeServer_notify_wait();
+    }
 }
 
 
@@ -84,51 +579,119 @@ int run()
 
     Debug_LOG_INFO("Starting TemperatureSensor...");
 
-    ret = helper_func_getConfigParameter(&hConfig,
-                                         DOMAIN_SENSOR,
-                                         MQTT_PAYLOAD_NAME,
-                                         &payload,
-                                         sizeof(payload));
+    ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSOR_MQTT_PAYLOAD,
+              &payload,
+              sizeof(payload));
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
-                        MQTT_PAYLOAD_NAME, ret);
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSOR_MQTT_PAYLOAD_NAME, ret);
         return ret;
     }
     Debug_LOG_INFO("Retrieved MQTT Payload: %s", payload);
 
 
-    ret = helper_func_getConfigParameter(&hConfig,
-                                         DOMAIN_SENSOR,
-                                         MQTT_TOPIC_NAME,
-                                         &topic,
-                                         sizeof(topic));
+    ret = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSOR_MQTT_TOPIC,
+              &topic,
+              sizeof(topic));
     if (ret != OS_SUCCESS)
     {
-        Debug_LOG_ERROR("helper_func_getConfigParameter() for param %s failed with :%d",
-                        MQTT_TOPIC_NAME, ret);
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSOR_MQTT_TOPIC_NAME, ret);
         return ret;
     }
 
-    MQTTString mqttTopic = MQTTString_initializer;
-    mqttTopic.cstring = topic;
-    Debug_LOG_INFO("Retrieved MQTT Topic: %s", mqttTopic.cstring);
+    Debug_LOG_INFO("Retrieved MQTT Topic: %s", topic);
 
-    unsigned char serializedMsg[320]; //arbitrary size
-    int len = MQTTSerialize_publish(serializedMsg,
-                                    sizeof(serializedMsg),
-                                    0,
-                                    1,
-                                    0,
-                                    1,
-                                    mqttTopic,
-                                    (unsigned char*)payload,
-                                    strlen((const char*)payload));
+    ret = initializeSampling();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("initializeSampling() failed with:%d", ret);
+        return ret;
+    }
+
+    ret = initializeTick();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("initializeTick() failed with:%d", ret);
+        return ret;
+    }
+
+    ret = startTick();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("startTick() failed with:%d", ret);
+        return ret;
+    }
+
+    // the topic name is sent once, the readings refer to it by its id
+    size_t len;
+    sensor_record_t record =
+    {
+        .type          = SENSOR_RECORD_TYPE_TOPIC,
+        .topicId       = SENSOR_TOPIC_ID,
+        .value.dataLen = strlen(topic),
+    };
+    ret = sensor_record_write(frame, sizeof(frame), &record, topic, &len);
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("sensor_record_write() failed with :%d", ret);
+        return ret;
+    }
+
+    while ((ret = CloudConnector_write(frame, len, NULL)) != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("CloudConnector_write() for topic failed with :%d",
+                          ret);
+        timeServer_notify_wait();
+    }
+
+    if (sampleRate_hz > 0)
+    {
+        runSampling();
+    }
+
+    uint32_t ticket;
+    bool hasTicket = false;
+
+    record.type          = SENSOR_RECORD_TYPE_TEXT;
+    record.seq           = 0;
 
     for (;;)
     {
-        CloudConnector_write(serializedMsg, (void*)cloudConnector_port,
-                             len);
+        if (hasTicket && !msg_ring_isReleased(&cloudConnectorRing, ticket))
+        {
+            Debug_LOG_WARNING("reading #%u not delivered yet", ticket);
+        }
+
+        applyConfigChanges();
+        record.value.dataLen = strlen((const char*)payload);
+
+        ret = TimeServer_getTime(&timer, TimeServer_PRECISION_MSEC,
+                                 &record.timestamp_ms);
+        if (ret != OS_SUCCESS)
+        {
+            Debug_LOG_WARNING("TimeServer_getTime() failed with :%d", ret);
+        }
+        adaptTick(record.timestamp_ms);
+
+        ret = sensor_record_write(frame, sizeof(frame), &record, payload, &len);
+        if (ret == OS_SUCCESS)
+        {
+            ret = CloudConnector_write(frame, len, &ticket);
+        }
+        if (ret != OS_SUCCESS)
+        {
+            // the CloudConnector does not keep up, drop this reading. The
+            // gap in the sequence numbers tells the CloudConnector about it.
+            Debug_LOG_WARNING("CloudConnector_write() failed with :%d", ret);
+        }
+        hasTicket = (ret == OS_SUCCESS);
+        record.seq++;
 
         timeServer_notify_wait();
     }
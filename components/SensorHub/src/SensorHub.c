@@ -0,0 +1,536 @@
+/**
+ * SensorHub component that emulates many sensors sending readings to the
+ * CloudConnector.
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "lib_debug/Debug.h"
+
+#include "OS_ConfigService.h"
+#include "OS_Dataport.h"
+
+#include "config_params.h"
+#include "helper_func.h"
+#include "cfg_text.h"
+#include "msg_ring.h"
+#include "sensor_record.h"
+
+#include "running_stats.h"
+#include "timer_wheel.h"
+
+#include "TimeServer.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <camkes.h>
+
+/* Defines -------------------------------------------------------------------*/
+// The sources are configured in groups, one per line:
+//   <topic> <count> <period_ms> <generator> [<min> <max>]
+// All sources of a group share the topic, which is extended by the instance
+// number of the source. Each group has a topic id of its own.
+#define SENSORHUB_MAX_GROUPS    SENSOR_RECORD_MAX_TOPICS
+#define SENSORHUB_MAX_SOURCES   4096
+#define SENSORHUB_TOPIC_SIZE    64
+#define SOURCES_CFG_SIZE        1024
+
+// the size in "config_params.h" is generated from the configuration xml file,
+// the text is read with a terminating zero
+#if (CONFIG_PARAM_SENSORHUB_SOURCES_MAX_SIZE >= SOURCES_CFG_SIZE)
+#error "Sources does not fit into sourcesCfg"
+#endif
+
+// the statistics of the groups are logged and reset with this period
+#define STATS_PERIOD_MS         10000
+
+typedef enum
+{
+    GENERATOR_CONST,
+    GENERATOR_RAMP,
+    GENERATOR_WALK,
+} generator_t;
+
+typedef struct
+{
+    char                topic[SENSORHUB_TOPIC_SIZE];
+    uint32_t            count;
+    uint32_t            period_ticks;
+    generator_t         generator;
+    double              min;
+    double              max;
+    uint32_t            seq; // shared by the sources, gaps show drops
+
+    struct
+    {
+        uint32_t        sent;
+        uint32_t        dropped;
+        running_stats_t lateness_ms; // of all sources of the group
+    } stats;
+} group_t;
+
+// the timer comes first, an expired timer is its source
+typedef struct
+{
+    timer_wheel_timer_t timer;
+    uint16_t            group;
+    uint32_t            instance;
+    double              value;
+    running_stats_t     lateness_ms;
+} source_t;
+
+OS_ConfigServiceHandle_t hConfig;
+
+static const if_OS_Timer_t timer =
+    IF_OS_TIMER_ASSIGN(
+        timeServer_rpc,
+        timeServer_notify);
+
+static msg_ring_t cloudConnectorRing;
+
+static char sourcesCfg[SOURCES_CFG_SIZE];
+static uint32_t tick_ms;
+
+static group_t groups[SENSORHUB_MAX_GROUPS];
+static size_t numGroups;
+
+static source_t sources[SENSORHUB_MAX_SOURCES];
+static size_t numSources;
+
+// all sources are driven by a single tick of the TimeServer
+static timer_wheel_t wheel;
+static uint64_t start_ms;
+static uint64_t statsStart_ms;
+
+static OS_Error_t
+initializeSensorHub(void)
+{
+    static OS_ConfigService_ClientCtx_t ctx =
+    {
+        .dataport = OS_DATAPORT_ASSIGN(configServer_port)
+    };
+    OS_Error_t err = OS_ConfigService_createHandleRemote(
+                         &ctx,
+                         &hConfig);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("OS_ConfigService_createHandleRemote() failed with :%d", err);
+        return err;
+    }
+
+    // parameters are read from the snapshot of the ConfigServer, if there is one
+    helper_func_attachConfigSnapshot(
+        (OS_Dataport_t) OS_DATAPORT_ASSIGN(configSnapshot_port));
+
+    OS_Dataport_t port = OS_DATAPORT_ASSIGN(cloudConnector_port);
+    err = msg_ring_init(&cloudConnectorRing,
+                        OS_Dataport_getBuf(port),
+                        OS_Dataport_getSize(port));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("msg_ring_init() failed with :%d", err);
+        return err;
+    }
+
+    return OS_SUCCESS;
+}
+
+static OS_Error_t
+parseGroup(
+    const char* line)
+{
+    if (numGroups >= SENSORHUB_MAX_GROUPS)
+    {
+        Debug_LOG_ERROR("more than %d source groups", SENSORHUB_MAX_GROUPS);
+        return OS_ERROR_INSUFFICIENT_SPACE;
+    }
+
+    group_t* group = &groups[numGroups];
+    char generator[16];
+    uint32_t period_ms;
+    group->min = 0.0;
+    group->max = 0.0;
+
+    int cnt = sscanf(line, "%63s %u %u %15s %lf %lf",
+                     group->topic, &group->count, &period_ms, generator,
+                     &group->min, &group->max);
+    if ((cnt != 4) && (cnt != 6))
+    {
+        Debug_LOG_ERROR("invalid source group '%s'", line);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if (0 == strcmp(generator, "const"))
+    {
+        group->generator = GENERATOR_CONST;
+    }
+    else if (0 == strcmp(generator, "ramp"))
+    {
+        group->generator = GENERATOR_RAMP;
+    }
+    else if (0 == strcmp(generator, "walk"))
+    {
+        group->generator = GENERATOR_WALK;
+    }
+    else
+    {
+        Debug_LOG_ERROR("unknown generator '%s'", generator);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if ((0 == group->count) || (group->count > SENSORHUB_MAX_SOURCES - numSources)
+        || (period_ms < tick_ms) || (group->min > group->max))
+    {
+        Debug_LOG_ERROR("invalid source group '%s', at most %zu sources left, "
+                        "period must be at least %u ms", line,
+                        SENSORHUB_MAX_SOURCES - numSources, tick_ms);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    // the period is rounded to whole ticks
+    group->period_ticks = (period_ms + tick_ms / 2) / tick_ms;
+
+    for (uint32_t i = 0; i < group->count; i++)
+    {
+        source_t* source = &sources[numSources + i];
+        source->group    = (uint16_t)numGroups;
+        source->instance = i;
+        source->value    = group->min;
+    }
+
+    Debug_LOG_INFO("group %zu: %u x '%s' every %u ticks", numGroups,
+                   group->count, group->topic, group->period_ticks);
+
+    numSources += group->count;
+    numGroups++;
+
+    return OS_SUCCESS;
+}
+
+static OS_Error_t
+initializeSources(void)
+{
+    OS_Error_t err = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSORHUB_TICK_MS,
+              &tick_ms,
+              sizeof(tick_ms));
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSORHUB_TICK_MS_NAME, err);
+        return err;
+    }
+
+    if (0 == tick_ms)
+    {
+        Debug_LOG_ERROR("invalid tick of 0 ms");
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    err = helper_func_getConfigParameterById(
+              &hConfig,
+              CONFIG_PARAM_SENSORHUB_SOURCES,
+              sourcesCfg,
+              sizeof(sourcesCfg) - 1);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("helper_func_getConfigParameterById() for param %s failed with :%d",
+                        CONFIG_PARAM_SENSORHUB_SOURCES_NAME, err);
+        return err;
+    }
+
+    size_t pos = 0;
+    char line[128];
+    while (cfg_text_nextLine(sourcesCfg, sizeof(sourcesCfg), &pos, line,
+                             sizeof(line)))
+    {
+        err = parseGroup(line);
+        if (err != OS_SUCCESS)
+        {
+            return err;
+        }
+    }
+
+    return OS_SUCCESS;
+}
+
+// The readings are enqueued without notifying the CloudConnector, it is
+// notified once per tick.
+static OS_Error_t
+sendRecord(
+    const sensor_record_t*  record,
+    const void*             data)
+{
+    static uint8_t frame[sizeof(sensor_record_t) + SENSORHUB_TOPIC_SIZE];
+
+    size_t len;
+    OS_Error_t err = sensor_record_write(frame, sizeof(frame), record, data,
+                                         &len);
+    if (err != OS_SUCCESS)
+    {
+        return err;
+    }
+
+    return msg_ring_enqueue(&cloudConnectorRing, frame, len, NULL);
+}
+
+static OS_Error_t
+announceTopics(void)
+{
+    for (size_t i = 0; i < numGroups; i++)
+    {
+        sensor_record_t record =
+        {
+            .type          = SENSOR_RECORD_TYPE_TOPIC,
+            .topicId       = (uint16_t)i,
+            .value.dataLen = strlen(groups[i].topic),
+        };
+
+        OS_Error_t err;
+        while ((err = sendRecord(&record, groups[i].topic)) != OS_SUCCESS)
+        {
+            if (err != OS_ERROR_INSUFFICIENT_SPACE)
+            {
+                Debug_LOG_ERROR("sendRecord() for topic failed with :%d", err);
+                return err;
+            }
+            cloudConnector_notify_emit();
+            timeServer_notify_wait();
+        }
+    }
+
+    cloudConnector_notify_emit();
+    return OS_SUCCESS;
+}
+
+static double
+generateValue(
+    source_t*   source,
+    group_t*    group)
+{
+    static uint32_t rng = 1;
+    const double range = group->max - group->min;
+
+    switch (group->generator)
+    {
+    case GENERATOR_RAMP:
+        // a saw tooth that rises by a sixteenth of the range per reading
+        source->value += range / 16;
+        if (source->value > group->max)
+        {
+            source->value = group->min;
+        }
+        break;
+    case GENERATOR_WALK:
+        rng = rng * 1103515245 + 12345;
+        source->value += (((double)((rng >> 16) % 21) - 10.0) / 100.0) * range;
+        if ((source->value < group->min) || (source->value > group->max))
+        {
+            source->value = group->min + range / 2;
+        }
+        break;
+    case GENERATOR_CONST:
+    default:
+        break;
+    }
+
+    return source->value;
+}
+
+// Called by the timer wheel for every source that is due, ctx points to the
+// current time.
+static void
+onSourceExpired(
+    timer_wheel_timer_t*    t,
+    void*                   ctx)
+{
+    source_t* source = (source_t*)t;
+    group_t* group = &groups[source->group];
+    const uint64_t now_ms = *(const uint64_t*)ctx;
+
+    // the tick only tells that the reading is due, how late it comes is the
+    // jitter of the source
+    const uint64_t due_ms = start_ms + (t->expires * tick_ms);
+    const double lateness_ms = (now_ms > due_ms) ? (double)(now_ms - due_ms)
+                               : 0.0;
+    running_stats_add(&source->lateness_ms, lateness_ms);
+    running_stats_add(&group->stats.lateness_ms, lateness_ms);
+
+    sensor_record_t record =
+    {
+        .type         = SENSOR_RECORD_TYPE_F64,
+        .flags        = SENSOR_RECORD_FLAG_INSTANCE,
+        .topicId      = source->group,
+        .seq          = group->seq++,
+        .timestamp_ms = now_ms,
+        .value.f64    = generateValue(source, group),
+        .instance     = source->instance,
+    };
+    if (sendRecord(&record, NULL) == OS_SUCCESS)
+    {
+        group->stats.sent++;
+    }
+    else
+    {
+        // the CloudConnector does not keep up, drop this reading
+        group->stats.dropped++;
+    }
+
+    timer_wheel_add(&wheel, t, t->expires + group->period_ticks);
+}
+
+static void
+startSources(void)
+{
+    timer_wheel_init(&wheel, 0);
+
+    // the sources of a group are spread evenly over its period, so they don't
+    // all fire in the same tick
+    for (size_t i = 0; i < numSources; i++)
+    {
+        source_t* source = &sources[i];
+        const group_t* group = &groups[source->group];
+
+        running_stats_reset(&source->lateness_ms);
+        timer_wheel_add(&wheel, &source->timer,
+                        1 + ((uint64_t)source->instance * group->period_ticks)
+                        / group->count);
+    }
+}
+
+static void
+logStats(
+    uint64_t now_ms)
+{
+    const uint64_t elapsed_ms = now_ms - statsStart_ms;
+    if (elapsed_ms < STATS_PERIOD_MS)
+    {
+        return;
+    }
+
+    source_t* source = sources;
+    for (size_t i = 0; i < numGroups; i++)
+    {
+        group_t* group = &groups[i];
+
+        // the source with the largest lateness is the one to look at first
+        double maxStdDev = 0.0;
+        double maxLateness = 0.0;
+        uint32_t worst = 0;
+        for (uint32_t j = 0; j < group->count; j++, source++)
+        {
+            double stdDev = running_stats_getStdDev(&source->lateness_ms);
+            if (stdDev > maxStdDev)
+            {
+                maxStdDev = stdDev;
+            }
+            if (source->lateness_ms.max > maxLateness)
+            {
+                maxLateness = source->lateness_ms.max;
+                worst = source->instance;
+            }
+            running_stats_reset(&source->lateness_ms);
+        }
+
+        Debug_LOG_INFO("%s: %u sent, %u dropped, %" PRIu64 " readings/s, "
+                       "lateness mean %.2f ms, max stddev %.2f ms, "
+                       "max %.0f ms at instance %u",
+                       group->topic, group->stats.sent, group->stats.dropped,
+                       group->stats.sent * 1000ULL / elapsed_ms,
+                       group->stats.lateness_ms.mean, maxStdDev,
+                       maxLateness, worst);
+
+        group->stats.sent = 0;
+        group->stats.dropped = 0;
+        running_stats_reset(&group->stats.lateness_ms);
+    }
+
+    statsStart_ms = now_ms;
+}
+
+static uint64_t
+getTime(void)
+{
+    uint64_t now_ms = 0;
+    OS_Error_t err = TimeServer_getTime(&timer, TimeServer_PRECISION_MSEC,
+                                        &now_ms);
+    if (err != OS_SUCCESS)
+    {
+        Debug_LOG_WARNING("TimeServer_getTime() failed with :%d", err);
+    }
+
+    return now_ms;
+}
+
+
+int run()
+{
+    OS_Error_t ret = initializeSensorHub();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("initializeSensorHub() failed with:%d", ret);
+        return ret;
+    }
+
+    ret = initializeSources();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("initializeSources() failed with:%d", ret);
+        return ret;
+    }
+
+    if (0 == numSources)
+    {
+        Debug_LOG_INFO("No sources configured");
+        return 0;
+    }
+
+    Debug_LOG_INFO("Starting SensorHub with %zu sources in %zu groups, "
+                   "tick %u ms", numSources, numGroups, tick_ms);
+
+    // set up a tick with the local timer ID 1. The local timer ID 0 is used for
+    // the sleep() function of the TimeServer
+    int err = timeServer_rpc_periodic(1, (uint64_t)tick_ms * NS_IN_MS);
+    if (0 != err)
+    {
+        Debug_LOG_ERROR("timeServer_rpc_periodic() failed, code %d", err);
+        return OS_ERROR_GENERIC;
+    }
+
+    ret = announceTopics();
+    if (ret != OS_SUCCESS)
+    {
+        Debug_LOG_ERROR("announceTopics() failed with:%d", ret);
+        return ret;
+    }
+
+    start_ms = getTime();
+    statsStart_ms = start_ms;
+    startSources();
+
+    for (;;)
+    {
+        timeServer_notify_wait();
+
+        // ticks that were missed are caught up, the readings are late then
+        uint64_t now_ms = getTime();
+        uint32_t numExpired = timer_wheel_advance(&wheel,
+                                                  (now_ms - start_ms) / tick_ms,
+                                                  onSourceExpired,
+                                                  &now_ms);
+        if (numExpired > 0)
+        {
+            cloudConnector_notify_emit();
+        }
+
+        logStats(now_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Running mean and standard deviation of a series of values
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "running_stats.h"
+
+#include "lib_debug/Debug.h"
+
+#include <math.h>
+
+//------------------------------------------------------------------------------
+void
+running_stats_reset(
+    running_stats_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    self->count = 0;
+    self->mean  = 0.0;
+    self->m2    = 0.0;
+    self->max   = 0.0;
+}
+
+//------------------------------------------------------------------------------
+void
+running_stats_add(
+    running_stats_t*    self,
+    double              value)
+{
+    Debug_ASSERT_SELF(self);
+
+    self->count++;
+    const double delta = value - self->mean;
+    self->mean += delta / self->count;
+    self->m2   += delta * (value - self->mean);
+
+    if ((1 == self->count) || (value > self->max))
+    {
+        self->max = value;
+    }
+}
+
+//------------------------------------------------------------------------------
+double
+running_stats_getStdDev(
+    const running_stats_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    if (self->count < 2)
+    {
+        return 0.0;
+    }
+
+    return sqrt(self->m2 / self->count);
+}
@@ -0,0 +1,39 @@
+/*
+ * Running mean and standard deviation of a series of values
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Welford's algorithm, it needs no buffer and does not lose precision on long
+// series.
+typedef struct
+{
+    uint32_t    count;
+    double      mean;
+    double      m2;  // sum of the squared distances from the mean
+    double      max;
+} running_stats_t;
+
+
+//------------------------------------------------------------------------------
+void
+running_stats_reset(
+    running_stats_t* self);
+
+void
+running_stats_add(
+    running_stats_t*    self,
+    double              value);
+
+// Population standard deviation, 0 for less than two values.
+double
+running_stats_getStdDev(
+    const running_stats_t* self);
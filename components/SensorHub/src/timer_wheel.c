@@ -0,0 +1,150 @@
+/*
+ * Hierarchical timer wheel
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "timer_wheel.h"
+
+#include "lib_debug/Debug.h"
+
+#include <string.h>
+
+#define SLOT_MASK   (TIMER_WHEEL_SLOTS - 1)
+
+//------------------------------------------------------------------------------
+static unsigned int
+getSlot(
+    uint64_t        tick,
+    unsigned int    level)
+{
+    return (tick >> (level * TIMER_WHEEL_SLOT_BITS)) & SLOT_MASK;
+}
+
+//------------------------------------------------------------------------------
+static void
+insert(
+    timer_wheel_t*          self,
+    timer_wheel_timer_t*    timer)
+{
+    // a timer goes to the lowest level that reaches its expiry
+    uint64_t delta = timer->expires - self->now;
+    unsigned int level = 0;
+    while ((level < TIMER_WHEEL_LEVELS - 1)
+           && (delta >= (1ull << ((level + 1) * TIMER_WHEEL_SLOT_BITS))))
+    {
+        level++;
+    }
+
+    // beyond the span, wait in the slot that comes around last
+    uint64_t tick = timer->expires;
+    if (delta >= TIMER_WHEEL_SPAN)
+    {
+        tick = self->now + TIMER_WHEEL_SPAN - 1;
+    }
+
+    timer_wheel_timer_t** slot = &self->slots[level][getSlot(tick, level)];
+    timer->next = *slot;
+    *slot = timer;
+}
+
+//------------------------------------------------------------------------------
+// Put the timers of a slot of an upper level into the levels below.
+static void
+cascade(
+    timer_wheel_t*  self,
+    unsigned int    level)
+{
+    timer_wheel_timer_t** slot = &self->slots[level][getSlot(self->now, level)];
+    timer_wheel_timer_t* timer = *slot;
+    *slot = NULL;
+
+    while (NULL != timer)
+    {
+        timer_wheel_timer_t* next = timer->next;
+        insert(self, timer);
+        timer = next;
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+timer_wheel_init(
+    timer_wheel_t*  self,
+    uint64_t        now)
+{
+    Debug_ASSERT_SELF(self);
+
+    memset(self->slots, 0, sizeof(self->slots));
+    self->now = now;
+}
+
+//------------------------------------------------------------------------------
+void
+timer_wheel_add(
+    timer_wheel_t*          self,
+    timer_wheel_timer_t*    timer,
+    uint64_t                expires)
+{
+    Debug_ASSERT_SELF(self);
+    Debug_ASSERT(NULL != timer);
+
+    timer->expires = (expires > self->now) ? expires : (self->now + 1);
+    insert(self, timer);
+}
+
+//------------------------------------------------------------------------------
+uint32_t
+timer_wheel_advance(
+    timer_wheel_t*          self,
+    uint64_t                now,
+    timer_wheel_callback_t  callback,
+    void*                   ctx)
+{
+    Debug_ASSERT_SELF(self);
+    Debug_ASSERT(NULL != callback);
+
+    uint32_t numExpired = 0;
+
+    while (self->now < now)
+    {
+        self->now++;
+
+        // when a level wraps around, the next slot of the level above is due
+        for (unsigned int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            if (getSlot(self->now, level - 1) != 0)
+            {
+                break;
+            }
+            cascade(self, level);
+        }
+
+        // the callbacks may add timers, also to this slot
+        timer_wheel_timer_t** slot = &self->slots[0][getSlot(self->now, 0)];
+        timer_wheel_timer_t* timer = *slot;
+        *slot = NULL;
+
+        while (NULL != timer)
+        {
+            timer_wheel_timer_t* next = timer->next;
+            if (timer->expires <= self->now)
+            {
+                numExpired++;
+                callback(timer, ctx);
+            }
+            else
+            {
+                // waited beyond the span, not due yet
+                insert(self, timer);
+            }
+            timer = next;
+        }
+    }
+
+    return numExpired;
+}
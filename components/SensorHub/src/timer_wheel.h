@@ -0,0 +1,63 @@
+/*
+ * Hierarchical timer wheel
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Each level has 64 slots, a slot of a level covers all slots of the level
+// below. Timers further ahead than the span of the wheel wait in the last level
+// and are put back when it comes around.
+#define TIMER_WHEEL_LEVELS      3
+#define TIMER_WHEEL_SLOT_BITS   6
+#define TIMER_WHEEL_SLOTS       (1u << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SPAN        (1ull << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS))
+
+// The timer is embedded into the object that is to be timed.
+typedef struct timer_wheel_timer
+{
+    struct timer_wheel_timer*   next;
+    uint64_t                    expires; // tick
+} timer_wheel_timer_t;
+
+typedef struct
+{
+    timer_wheel_timer_t*    slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t                now; // tick
+} timer_wheel_t;
+
+// Called for an expired timer. It may add the timer again.
+typedef void (*timer_wheel_callback_t)(
+    timer_wheel_timer_t*    timer,
+    void*                   ctx);
+
+
+//------------------------------------------------------------------------------
+void
+timer_wheel_init(
+    timer_wheel_t*  self,
+    uint64_t        now);
+
+// Add a timer that expires at the given tick. A timer that has expired already
+// expires with the next tick. The cost does not depend on the number of timers.
+void
+timer_wheel_add(
+    timer_wheel_t*          self,
+    timer_wheel_timer_t*    timer,
+    uint64_t                expires);
+
+// Advance the wheel tick by tick up to now and call the callback for every
+// timer that expires on the way. Returns the number of expired timers.
+uint32_t
+timer_wheel_advance(
+    timer_wheel_t*          self,
+    uint64_t                now,
+    timer_wheel_callback_t  callback,
+    void*                   ctx);
@@ -0,0 +1,54 @@
+/*
+ * Line based text configuration
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "cfg_text.h"
+
+#include "lib_debug/Debug.h"
+
+//------------------------------------------------------------------------------
+bool
+cfg_text_nextLine(
+    const char* text,
+    size_t      textLen,
+    size_t*     pos,
+    char*       line,
+    size_t      lineSize)
+{
+    Debug_ASSERT(NULL != text);
+    Debug_ASSERT(NULL != pos);
+    Debug_ASSERT((NULL != line) && (lineSize > 0));
+
+    while ((*pos < textLen) && (text[*pos] != '\0'))
+    {
+        size_t len = 0;
+        while ((*pos < textLen) && (text[*pos] != '\0')
+               && (text[*pos] != '\n'))
+        {
+            if (len < lineSize - 1)
+            {
+                line[len++] = text[*pos];
+            }
+            (*pos)++;
+        }
+        line[len] = '\0';
+
+        if ((*pos < textLen) && (text[*pos] == '\n'))
+        {
+            (*pos)++;
+        }
+
+        if ((len > 0) && (line[0] != '#'))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,27 @@
+/*
+ * Line based text configuration
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Copy the next line of a configuration text into a NULL-terminated buffer,
+// skipping empty lines and comment lines starting with '#'. Overlong lines are
+// truncated. The text ends at textLen or at the first NULL char, as blob
+// parameters from the ConfigServer may have trailing padding. Returns false if
+// there are no more lines.
+bool
+cfg_text_nextLine(
+    const char* text,
+    size_t      textLen,
+    size_t*     pos,
+    char*       line,
+    size_t      lineSize);
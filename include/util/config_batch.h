@@ -0,0 +1,56 @@
+/*
+ * Batched parameter get RPC of the ConfigServer
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_ConfigService.h"
+#include "OS_Dataport.h"
+#include "OS_Error.h"
+
+#include <stdint.h>
+
+// The client writes an array of requests to the start of its ConfigServer
+// dataport and calls the RPC with their number. The ConfigServer overwrites
+// them with an array of replies of the same length, followed by the values.
+// A value that does not fit into the rest of the dataport is returned in
+// part, the client requests the rest with the offset of the next chunk.
+#define CONFIG_BATCH_MAX_REQUESTS   16
+#define CONFIG_BATCH_ALIGNMENT      8
+
+typedef struct
+{
+    char        domain[OS_CONFIG_LIB_DOMAIN_NAME_SIZE];
+    char        parameter[OS_CONFIG_LIB_PARAMETER_NAME_SIZE];
+    uint32_t    offset;     // of the requested chunk in the value
+    uint32_t    reserved;
+} config_batch_request_t;
+
+typedef struct
+{
+    int32_t     err;        // OS_Error_t
+    uint32_t    size;       // of the whole value
+    uint32_t    offset;     // of the chunk in the value
+    uint32_t    len;        // of the chunk
+    uint32_t    dataOffset; // of the chunk in the dataport
+    uint32_t    reserved;
+} config_batch_reply_t;
+
+// client side of the RPC
+typedef struct
+{
+    OS_Error_t      (*getParameters)(uint32_t numRequests);
+    OS_Dataport_t   dataport;
+} if_ConfigBatch_t;
+
+#define IF_CONFIG_BATCH_ASSIGN(_rpc_, _port_) \
+{ \
+    .getParameters  = _rpc_##_getParameters, \
+    .dataport       = OS_DATAPORT_ASSIGN(_port_) \
+}
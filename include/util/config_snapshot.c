@@ -0,0 +1,287 @@
+/*
+ * Read-only snapshot of a config domain in a dataport shared with a client
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "config_snapshot.h"
+
+#include "lib_debug/Debug.h"
+
+#include <string.h>
+
+//------------------------------------------------------------------------------
+static config_snapshot_entry_t*
+getEntries(
+    uint8_t* buf)
+{
+    return (config_snapshot_entry_t*)&buf[sizeof(config_snapshot_header_t)];
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+config_snapshot_beginWrite(
+    config_snapshot_writer_t*   self,
+    void*                       buf,
+    size_t                      size,
+    const char*                 domain)
+{
+    Debug_ASSERT_SELF(self);
+
+    if ((NULL == buf) || (size < sizeof(config_snapshot_header_t))
+        || (((uintptr_t)buf % CONFIG_SNAPSHOT_ALIGNMENT) != 0))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    config_snapshot_header_t* header = buf;
+
+    // readers that have started meanwhile see an odd or another number
+    const uint32_t seq = __atomic_load_n(&header->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->seq, (seq & 1) ? seq : (seq + 1),
+                     __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    header->magic      = CONFIG_SNAPSHOT_MAGIC;
+    header->numEntries = 0;
+    header->isComplete = 0;
+    memset(header->domain, 0, sizeof(header->domain));
+    strncpy(header->domain, domain, sizeof(header->domain) - 1);
+
+    self->buf         = buf;
+    self->size        = size & ~((size_t)CONFIG_SNAPSHOT_ALIGNMENT - 1);
+    self->entriesEnd  = sizeof(config_snapshot_header_t);
+    self->valuesStart = self->size;
+    self->numEntries  = 0;
+    self->isComplete  = true;
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+config_snapshot_add(
+    config_snapshot_writer_t*   self,
+    const char*                 name,
+    const void*                 value,
+    size_t                      len,
+    uint32_t                    version)
+{
+    Debug_ASSERT_SELF(self);
+
+    const size_t alignedLen = (len + CONFIG_SNAPSHOT_ALIGNMENT - 1)
+                              & ~((size_t)CONFIG_SNAPSHOT_ALIGNMENT - 1);
+    if ((strlen(name) >= CONFIG_SNAPSHOT_NAME_SIZE)
+        || (self->valuesStart - self->entriesEnd
+            < sizeof(config_snapshot_entry_t) + alignedLen))
+    {
+        self->isComplete = false;
+        return OS_ERROR_INSUFFICIENT_SPACE;
+    }
+
+    self->valuesStart -= alignedLen;
+    memcpy(&self->buf[self->valuesStart], value, len);
+
+    config_snapshot_entry_t* entry = &getEntries(self->buf)[self->numEntries];
+    memset(entry->name, 0, sizeof(entry->name));
+    strncpy(entry->name, name, sizeof(entry->name) - 1);
+    entry->size     = (uint32_t)len;
+    entry->offset   = (uint32_t)self->valuesStart;
+    entry->version  = version;
+    entry->reserved = 0;
+
+    self->entriesEnd += sizeof(config_snapshot_entry_t);
+    self->numEntries++;
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+void
+config_snapshot_endWrite(
+    config_snapshot_writer_t*   self)
+{
+    Debug_ASSERT_SELF(self);
+
+    config_snapshot_header_t* header = (config_snapshot_header_t*)self->buf;
+    header->numEntries = self->numEntries;
+    header->isComplete = self->isComplete ? 1 : 0;
+    header->version++;
+
+    // the content must be visible before the even sequence number
+    const uint32_t seq = __atomic_load_n(&header->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------
+// One attempt, the result is only valid if the sequence number has not changed
+// meanwhile. The bounds are checked anyway, as the values may be torn.
+static OS_Error_t
+readOnce(
+    const uint8_t*  buf,
+    size_t          size,
+    const char*     domain,
+    const char*     name,
+    void*           value,
+    size_t          len,
+    uint32_t*       index,
+    uint32_t*       version)
+{
+    const config_snapshot_header_t* header =
+        (const config_snapshot_header_t*)buf;
+
+    if ((header->magic != CONFIG_SNAPSHOT_MAGIC)
+        || (0 != strncmp(header->domain, domain, sizeof(header->domain))))
+    {
+        return OS_ERROR_NOT_FOUND;
+    }
+
+    const uint32_t numEntries = header->numEntries;
+    const size_t maxEntries = (size - sizeof(*header))
+                              / sizeof(config_snapshot_entry_t);
+    if (numEntries > maxEntries)
+    {
+        return OS_ERROR_NOT_FOUND;
+    }
+
+    const config_snapshot_entry_t* entries =
+        (const config_snapshot_entry_t*)&buf[sizeof(*header)];
+
+    // the entry at the given index is checked first, then all of them
+    const uint32_t hint = (NULL != index) ? *index : 0;
+    for (uint32_t n = 0; n < numEntries; n++)
+    {
+        const uint32_t i = (hint + n) % numEntries;
+        const config_snapshot_entry_t* entry = &entries[i];
+        if (0 != strncmp(entry->name, name, sizeof(entry->name)))
+        {
+            continue;
+        }
+        if (NULL != index)
+        {
+            *index = i;
+        }
+
+        const uint32_t entrySize = entry->size;
+        const uint32_t offset = entry->offset;
+        if ((offset > size) || (entrySize > size - offset))
+        {
+            return OS_ERROR_NOT_FOUND;
+        }
+        *version = entry->version;
+        if (NULL == value)
+        {
+            return OS_SUCCESS;
+        }
+        if (entrySize > len)
+        {
+            return OS_ERROR_BUFFER_TOO_SMALL;
+        }
+        memcpy(value, &buf[offset], entrySize);
+        return OS_SUCCESS;
+    }
+
+    return header->isComplete ? OS_ERROR_CONFIG_PARAMETER_NOT_FOUND
+           : OS_ERROR_NOT_FOUND;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+config_snapshot_read(
+    const void* buf,
+    size_t      size,
+    const char* domain,
+    const char* name,
+    void*       value,
+    size_t      len,
+    uint32_t*   index,
+    uint32_t*   version)
+{
+    const config_snapshot_header_t* header = buf;
+
+    if ((NULL == buf) || (size < sizeof(*header)))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    for (unsigned int i = 0; i < CONFIG_SNAPSHOT_READ_TRIES; i++)
+    {
+        const uint32_t seq = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+        if (0 == seq)
+        {
+            // not written yet
+            return OS_ERROR_NOT_FOUND;
+        }
+        if (seq & 1)
+        {
+            continue;
+        }
+
+        uint32_t parameterVersion = 0;
+        OS_Error_t err = readOnce(buf, size, domain, name, value, len, index,
+                                  &parameterVersion);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->seq, __ATOMIC_RELAXED) == seq)
+        {
+            if (NULL != version)
+            {
+                *version = parameterVersion;
+            }
+            return err;
+        }
+    }
+
+    return OS_ERROR_TRY_AGAIN;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+config_snapshot_find(
+    const void*     buf,
+    size_t          size,
+    const char*     name,
+    const void**    value,
+    size_t*         len,
+    uint32_t*       version)
+{
+    const config_snapshot_header_t* header = buf;
+
+    if ((NULL == buf) || (size < sizeof(*header))
+        || (header->magic != CONFIG_SNAPSHOT_MAGIC) || (header->seq & 1))
+    {
+        return OS_ERROR_NOT_FOUND;
+    }
+
+    const uint32_t numEntries = header->numEntries;
+    if (numEntries > (size - sizeof(*header)) / sizeof(config_snapshot_entry_t))
+    {
+        return OS_ERROR_NOT_FOUND;
+    }
+
+    const config_snapshot_entry_t* entries =
+        (const config_snapshot_entry_t*)&((const uint8_t*)buf)[sizeof(*header)];
+    for (uint32_t i = 0; i < numEntries; i++)
+    {
+        const config_snapshot_entry_t* entry = &entries[i];
+        if (0 != strncmp(entry->name, name, sizeof(entry->name)))
+        {
+            continue;
+        }
+        if ((entry->offset > size) || (entry->size > size - entry->offset))
+        {
+            return OS_ERROR_NOT_FOUND;
+        }
+
+        *value   = &((const uint8_t*)buf)[entry->offset];
+        *len     = entry->size;
+        *version = entry->version;
+        return OS_SUCCESS;
+    }
+
+    return OS_ERROR_CONFIG_PARAMETER_NOT_FOUND;
+}
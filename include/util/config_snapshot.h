@@ -0,0 +1,113 @@
+/*
+ * Read-only snapshot of a config domain in a dataport shared with a client
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The ConfigServer writes the parameters of the domain of a client into a
+// dataport that the client only reads. The entries follow the header, the
+// values are stored from the end of the dataport downwards. The sequence
+// number is odd while the ConfigServer writes, readers retry then or if it
+// has changed while they read. An empty dataport (all zero) has no snapshot.
+#define CONFIG_SNAPSHOT_MAGIC       0x50414e53  // "SNAP"
+#define CONFIG_SNAPSHOT_ALIGNMENT   8
+#define CONFIG_SNAPSHOT_NAME_SIZE   32
+#define CONFIG_SNAPSHOT_READ_TRIES  8
+
+typedef struct
+{
+    uint32_t    magic;
+    uint32_t    seq;
+    uint32_t    version;    // incremented with every snapshot
+    uint32_t    numEntries;
+    uint32_t    isComplete; // all parameters of the domain are included
+    uint32_t    reserved;
+    char        domain[CONFIG_SNAPSHOT_NAME_SIZE];
+} config_snapshot_header_t;
+
+typedef struct
+{
+    char        name[CONFIG_SNAPSHOT_NAME_SIZE];
+    uint32_t    size;
+    uint32_t    offset;     // of the value in the dataport
+    uint32_t    version;    // incremented when the value changes
+    uint32_t    reserved;
+} config_snapshot_entry_t;
+
+// ConfigServer side
+typedef struct
+{
+    uint8_t*    buf;
+    size_t      size;
+    size_t      entriesEnd;
+    size_t      valuesStart;
+    uint32_t    numEntries;
+    bool        isComplete;
+} config_snapshot_writer_t;
+
+
+//------------------------------------------------------------------------------
+// Start a new snapshot of a domain, readers retry until it is finished.
+OS_Error_t
+config_snapshot_beginWrite(
+    config_snapshot_writer_t*   self,
+    void*                       buf,
+    size_t                      size,
+    const char*                 domain);
+
+// Add a parameter with the version of its value. If it does not fit, the
+// snapshot is marked as incomplete.
+OS_Error_t
+config_snapshot_add(
+    config_snapshot_writer_t*   self,
+    const char*                 name,
+    const void*                 value,
+    size_t                      len,
+    uint32_t                    version);
+
+void
+config_snapshot_endWrite(
+    config_snapshot_writer_t*   self);
+
+// Client side: copy a value from the snapshot. Returns
+// - OS_ERROR_CONFIG_PARAMETER_NOT_FOUND if the domain has no such parameter,
+// - OS_ERROR_NOT_FOUND if the snapshot can't tell, e.g. as it is not there
+//   yet, is of another domain or is incomplete,
+// - OS_ERROR_TRY_AGAIN if it has been changed during all tries.
+// If an index is given, the entry at this index is checked first, so a client
+// that remembers it finds a parameter without searching. It is updated with
+// the index of the parameter. The version of the parameter is returned, if
+// given. Without a value buffer, only the version is returned.
+OS_Error_t
+config_snapshot_read(
+    const void* buf,
+    size_t      size,
+    const char* domain,
+    const char* name,
+    void*       value,
+    size_t      len,
+    uint32_t*   index,
+    uint32_t*   version);
+
+// ConfigServer side: find a parameter in a snapshot that is not modified
+// meanwhile, e.g. a copy of the previous one. The value stays in the buffer.
+OS_Error_t
+config_snapshot_find(
+    const void*     buf,
+    size_t          size,
+    const char*     name,
+    const void**    value,
+    size_t*         len,
+    uint32_t*       version);
@@ -8,9 +8,71 @@
  * For commercial licensing, contact: info.cyber@hensoldt.net
  */
 
+#include <stdbool.h>
 #include <string.h>
 
 #include "helper_func.h"
+#include "config_params.h"
+
+// FNV-1a
+#define HASH_OFFSET_BASIS   2166136261u
+#define HASH_PRIME          16777619u
+
+typedef struct
+{
+    OS_ConfigServiceLibTypes_DomainName_t   name;
+    bool                                    isComplete; // all parameters cached
+} cache_domain_t;
+
+typedef struct
+{
+    uint32_t                                    hash; // 0 if unused
+    const cache_domain_t*                       domain;
+    OS_ConfigServiceLibTypes_ParameterName_t    name;
+    OS_ConfigServiceLibTypes_Parameter_t        parameter;
+    bool                                        isFound;
+    const void*                                 value; // NULL if not cached
+    size_t                                      valueLen;
+} cache_entry_t;
+
+static struct
+{
+    cache_domain_t  domains[HELPER_FUNC_CACHE_DOMAINS];
+    size_t          numDomains;
+    cache_entry_t   entries[HELPER_FUNC_CACHE_PARAMETERS];
+    uint8_t         arena[HELPER_FUNC_CACHE_ARENA_SIZE];
+    size_t          arenaUsed;
+} cache;
+
+static helper_func_configStats_t configStats;
+
+static OS_Dataport_t snapshotPort;
+static bool isSnapshotAttached = false;
+
+typedef struct
+{
+    const char* domain;
+    const char* name;
+    uint32_t    index;  // in the domain
+} param_info_t;
+
+#define PARAM_INFO(id, domain, name, index) [id] = { domain, name, index },
+
+static const param_info_t paramInfos[CONFIG_PARAM_COUNT] =
+{
+    CONFIG_PARAMS(PARAM_INFO)
+};
+
+// where a parameter looked up by id has been found
+typedef struct
+{
+    bool                    isBound;        // looked up before
+    uint32_t                snapshotIndex;
+    uint32_t                version;        // of the value read last
+    const cache_entry_t*    entry;          // NULL if not cached
+} param_slot_t;
+
+static param_slot_t paramSlots[CONFIG_PARAM_COUNT];
 
 // -----------------------------------------------------------------------------
 static
@@ -77,8 +139,10 @@ find_domain(
     OS_Error_t ret;
 
     OS_ConfigService_domainEnumeratorInit(handle, enumerator);
+    configStats.rpcs++;
     for (;;)
     {
+        configStats.rpcs++;
         ret = OS_ConfigService_domainEnumeratorGetElement(
                   handle,
                   enumerator,
@@ -98,6 +162,7 @@ find_domain(
             return OS_SUCCESS;
         }
 
+        configStats.rpcs++;
         ret = OS_ConfigService_domainEnumeratorIncrement(handle, enumerator);
         if (OS_SUCCESS != ret)
         {
@@ -133,6 +198,7 @@ get_parameter_element(
         return OS_ERROR_CONFIG_DOMAIN_NOT_FOUND;
     }
 
+    configStats.rpcs++;
     ret = OS_ConfigService_domainGetElement(
               handle,
               &domain,
@@ -148,22 +214,229 @@ get_parameter_element(
 }
 
 //------------------------------------------------------------------------------
+static
+uint32_t
+hash_name(
+    OS_ConfigServiceLibTypes_DomainName_t const* domainName,
+    OS_ConfigServiceLibTypes_ParameterName_t const* parameterName)
+{
+    uint32_t hash = HASH_OFFSET_BASIS;
+
+    for (size_t i = 0; (i < OS_CONFIG_LIB_DOMAIN_NAME_SIZE)
+         && (domainName->name[i] != '\0'); i++)
+    {
+        hash = (hash ^ (uint8_t)domainName->name[i]) * HASH_PRIME;
+    }
+    hash = (hash ^ '/') * HASH_PRIME;
+    for (size_t i = 0; (i < OS_CONFIG_LIB_PARAMETER_NAME_SIZE)
+         && (parameterName->name[i] != '\0'); i++)
+    {
+        hash = (hash ^ (uint8_t)parameterName->name[i]) * HASH_PRIME;
+    }
+
+    // 0 marks an unused entry
+    return (0 == hash) ? 1 : hash;
+}
+
+//------------------------------------------------------------------------------
+static
+cache_entry_t*
+cache_find(
+    const cache_domain_t* domain,
+    OS_ConfigServiceLibTypes_ParameterName_t const* parameterName,
+    uint32_t hash)
+{
+    // open addressing with linear probing, the table is never full
+    for (size_t i = 0; i < HELPER_FUNC_CACHE_PARAMETERS; i++)
+    {
+        cache_entry_t* entry =
+            &cache.entries[(hash + i) & (HELPER_FUNC_CACHE_PARAMETERS - 1)];
+        if (0 == entry->hash)
+        {
+            break;
+        }
+        if ((entry->hash == hash) && (entry->domain == domain)
+            && (0 == strncmp(entry->name.name, parameterName->name,
+                             OS_CONFIG_LIB_PARAMETER_NAME_SIZE)))
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+static
+cache_entry_t*
+cache_insert(
+    uint32_t hash)
+{
+    // one entry stays free, so a lookup always ends at an unused entry
+    size_t numUsed = 0;
+    for (size_t i = 0; i < HELPER_FUNC_CACHE_PARAMETERS; i++)
+    {
+        numUsed += (cache.entries[i].hash != 0) ? 1 : 0;
+    }
+    if (numUsed >= HELPER_FUNC_CACHE_PARAMETERS - 1)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; ; i++)
+    {
+        cache_entry_t* entry =
+            &cache.entries[(hash + i) & (HELPER_FUNC_CACHE_PARAMETERS - 1)];
+        if (0 == entry->hash)
+        {
+            entry->hash = hash;
+            return entry;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static
+const cache_domain_t*
+cache_getDomain(
+    OS_ConfigServiceLibTypes_DomainName_t const* domainName)
+{
+    for (size_t i = 0; i < cache.numDomains; i++)
+    {
+        if (OS_SUCCESS == compareDomainName(&cache.domains[i].name, domainName))
+        {
+            return &cache.domains[i];
+        }
+    }
+
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Fetch all parameters of a domain with their values, each one takes a get
+// element, a get value and an increment call.
+static
 OS_Error_t
-helper_func_getConfigParameter(OS_ConfigServiceHandle_t* handle,
-                               const char* DomainName,
-                               const char* ParameterName,
-                               void* parameterBuffer,
-                               size_t parameterLength)
+cache_loadDomain(
+    OS_ConfigServiceHandle_t handle,
+    OS_ConfigServiceLibTypes_DomainName_t const* domainName,
+    const cache_domain_t** cachedDomain)
+{
+    if (cache.numDomains >= HELPER_FUNC_CACHE_DOMAINS)
+    {
+        return OS_ERROR_INSUFFICIENT_SPACE;
+    }
+
+    OS_ConfigServiceLibTypes_Domain_t domain;
+    OS_ConfigServiceLibTypes_DomainEnumerator_t domainEnumerator = {0};
+    OS_Error_t ret = find_domain(handle, &domainEnumerator, domainName, &domain);
+    if (OS_SUCCESS != ret)
+    {
+        Debug_LOG_ERROR("find_domain() failed, ret %d", ret);
+        return OS_ERROR_CONFIG_DOMAIN_NOT_FOUND;
+    }
+
+    OS_ConfigServiceLibTypes_ParameterEnumerator_t enumerator = {0};
+    configStats.rpcs++;
+    ret = OS_ConfigService_parameterEnumeratorInit(handle, &domainEnumerator,
+                                                   &enumerator);
+    if (OS_SUCCESS != ret)
+    {
+        Debug_LOG_ERROR("parameterEnumeratorInit() failed, ret %d", ret);
+        return ret;
+    }
+
+    cache_domain_t* d = &cache.domains[cache.numDomains++];
+    d->name       = *domainName;
+    d->isComplete = true;
+
+    for (;;)
+    {
+        OS_ConfigServiceLibTypes_Parameter_t parameter;
+        configStats.rpcs++;
+        ret = OS_ConfigService_parameterEnumeratorGetElement(handle,
+                                                             &enumerator,
+                                                             &parameter);
+        if (OS_SUCCESS != ret)
+        {
+            Debug_LOG_ERROR("parameterEnumeratorGetElement() failed, ret %d",
+                            ret);
+            d->isComplete = false;
+            break;
+        }
+
+        OS_ConfigServiceLibTypes_ParameterName_t name;
+        OS_ConfigService_parameterGetName(&parameter, &name);
+
+        uint32_t hash = hash_name(domainName, &name);
+        cache_entry_t* entry = cache_insert(hash);
+        if (NULL == entry)
+        {
+            Debug_LOG_WARNING("config cache full, further parameters of "
+                              "domain '%s' are not cached", domainName->name);
+            d->isComplete = false;
+            break;
+        }
+        entry->domain    = d;
+        entry->name      = name;
+        entry->parameter = parameter;
+        entry->isFound   = true;
+        entry->value     = NULL;
+
+        // large values are fetched when they are looked up
+        size_t size = OS_ConfigService_parameterGetSize(&parameter);
+        if (size <= sizeof(cache.arena) - cache.arenaUsed)
+        {
+            size_t bytesCopied;
+            configStats.rpcs++;
+            ret = OS_ConfigService_parameterGetValue(
+                      handle,
+                      &parameter,
+                      &cache.arena[cache.arenaUsed],
+                      size,
+                      &bytesCopied);
+            if (OS_SUCCESS == ret)
+            {
+                entry->value    = &cache.arena[cache.arenaUsed];
+                entry->valueLen = bytesCopied;
+                // keep the values aligned
+                cache.arenaUsed += (bytesCopied + 7) & ~(size_t)7;
+            }
+        }
+
+        // the enumerator fails at the end of the domain
+        configStats.rpcs++;
+        if (OS_SUCCESS != OS_ConfigService_parameterEnumeratorIncrement(
+                handle,
+                &enumerator))
+        {
+            break;
+        }
+    }
+
+    *cachedDomain = d;
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// Look up a parameter without the cache.
+static
+OS_Error_t
+get_parameter_uncached(
+    OS_ConfigServiceHandle_t handle,
+    const char* DomainName,
+    const char* ParameterName,
+    void* parameterBuffer,
+    size_t parameterLength)
 {
     OS_Error_t ret;
     size_t bytesCopied;
     OS_ConfigServiceLibTypes_DomainName_t domainName;
     OS_ConfigServiceLibTypes_ParameterName_t parameterName;
     OS_ConfigServiceLibTypes_Parameter_t parameter;
-    OS_ConfigServiceHandle_t configHandle = *handle;
 
     ret = get_parameter_element(
-              configHandle,
+              handle,
               DomainName,
               ParameterName,
               &domainName,
@@ -175,11 +448,9 @@ helper_func_getConfigParameter(OS_ConfigServiceHandle_t* handle,
         return ret;
     }
 
-    OS_ConfigServiceLibTypes_ParameterType_t parameterType;
-    OS_ConfigService_parameterGetType(&parameter, &parameterType);
-
+    configStats.rpcs++;
     ret = OS_ConfigService_parameterGetValue(
-              configHandle,
+              handle,
               &parameter,
               parameterBuffer,
               parameterLength,
@@ -192,3 +463,528 @@ helper_func_getConfigParameter(OS_ConfigServiceHandle_t* handle,
 
     return OS_SUCCESS;
 }
+
+//------------------------------------------------------------------------------
+// Look up a parameter in the snapshot. Returns OS_ERROR_NOT_FOUND or
+// OS_ERROR_TRY_AGAIN if it must be looked up with RPCs.
+static
+OS_Error_t
+read_snapshot(
+    const char* DomainName,
+    const char* ParameterName,
+    void* parameterBuffer,
+    size_t parameterLength,
+    uint32_t* index,
+    uint32_t* version)
+{
+    if (!isSnapshotAttached)
+    {
+        return OS_ERROR_NOT_FOUND;
+    }
+
+    OS_Error_t ret = config_snapshot_read(OS_Dataport_getBuf(snapshotPort),
+                                          OS_Dataport_getSize(snapshotPort),
+                                          DomainName,
+                                          ParameterName,
+                                          parameterBuffer,
+                                          parameterLength,
+                                          index,
+                                          version);
+    if ((OS_ERROR_NOT_FOUND == ret) || (OS_ERROR_TRY_AGAIN == ret))
+    {
+        return ret;
+    }
+    if (OS_ERROR_BUFFER_TOO_SMALL == ret)
+    {
+        Debug_LOG_ERROR("parameter %s does not fit into %zu bytes",
+                        ParameterName, parameterLength);
+        return ret;
+    }
+
+    configStats.hits++;
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+// Copy the value of a cached parameter.
+static
+OS_Error_t
+copy_cached(
+    const cache_entry_t* entry,
+    void* parameterBuffer,
+    size_t parameterLength)
+{
+    if (!entry->isFound)
+    {
+        return OS_ERROR_CONFIG_PARAMETER_NOT_FOUND;
+    }
+
+    if (entry->valueLen > parameterLength)
+    {
+        Debug_LOG_ERROR("parameter %s of %zu bytes does not fit into %zu bytes",
+                        entry->name.name, entry->valueLen, parameterLength);
+        return OS_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    memcpy(parameterBuffer, entry->value, entry->valueLen);
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// Look up a parameter in the cache, the domain is loaded with the first lookup.
+// The cache entry is returned, if there is one with the value.
+static
+OS_Error_t
+get_parameter_cached(
+    OS_ConfigServiceHandle_t configHandle,
+    const char* DomainName,
+    const char* ParameterName,
+    void* parameterBuffer,
+    size_t parameterLength,
+    const cache_entry_t** cachedEntry)
+{
+    OS_Error_t ret;
+    OS_ConfigServiceLibTypes_DomainName_t domainName;
+    OS_ConfigServiceLibTypes_ParameterName_t parameterName;
+
+    initializeDomainName(&domainName, DomainName);
+    initializeParameterName(&parameterName, ParameterName);
+
+    const cache_domain_t* domain = cache_getDomain(&domainName);
+    const bool isLoaded = (NULL != domain);
+    if (!isLoaded)
+    {
+        ret = cache_loadDomain(configHandle, &domainName, &domain);
+        if (OS_ERROR_INSUFFICIENT_SPACE == ret)
+        {
+            // too many domains, this one is not cached
+            return get_parameter_uncached(configHandle, DomainName,
+                                          ParameterName, parameterBuffer,
+                                          parameterLength);
+        }
+        if (OS_SUCCESS != ret)
+        {
+            return ret;
+        }
+    }
+
+    const cache_entry_t* entry =
+        cache_find(domain, &parameterName, hash_name(&domainName,
+                                                     &parameterName));
+    if (NULL == entry)
+    {
+        if (!domain->isComplete)
+        {
+            return get_parameter_uncached(configHandle, DomainName,
+                                          ParameterName, parameterBuffer,
+                                          parameterLength);
+        }
+
+        // optional parameters are looked up as well, this is no error
+        Debug_LOG_DEBUG("parameter %s not found in domain %s",
+                        ParameterName, DomainName);
+        return OS_ERROR_CONFIG_PARAMETER_NOT_FOUND;
+    }
+
+    if (!entry->isFound)
+    {
+        configStats.hits++;
+        *cachedEntry = entry;
+        return OS_ERROR_CONFIG_PARAMETER_NOT_FOUND;
+    }
+
+    if (NULL == entry->value)
+    {
+        // the value did not fit into the arena
+        size_t bytesCopied;
+        configStats.rpcs++;
+        ret = OS_ConfigService_parameterGetValue(
+                  configHandle,
+                  &entry->parameter,
+                  parameterBuffer,
+                  parameterLength,
+                  &bytesCopied);
+        if (OS_SUCCESS != ret)
+        {
+            Debug_LOG_ERROR("parameterGetValue() failed, ret %d", ret);
+        }
+        return ret;
+    }
+
+    ret = copy_cached(entry, parameterBuffer, parameterLength);
+    if (OS_SUCCESS != ret)
+    {
+        return ret;
+    }
+
+    if (isLoaded)
+    {
+        configStats.hits++;
+    }
+    *cachedEntry = entry;
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+helper_func_getConfigParameter(OS_ConfigServiceHandle_t* handle,
+                               const char* DomainName,
+                               const char* ParameterName,
+                               void* parameterBuffer,
+                               size_t parameterLength)
+{
+    configStats.lookups++;
+
+    OS_Error_t ret = read_snapshot(DomainName, ParameterName, parameterBuffer,
+                                   parameterLength, NULL, NULL);
+    if ((OS_ERROR_NOT_FOUND != ret) && (OS_ERROR_TRY_AGAIN != ret))
+    {
+        return ret;
+    }
+
+    const cache_entry_t* entry = NULL;
+    return get_parameter_cached(*handle, DomainName, ParameterName,
+                                parameterBuffer, parameterLength, &entry);
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+helper_func_getConfigParameterById(
+    OS_ConfigServiceHandle_t*   handle,
+    uint32_t                    id,
+    void*                       parameterBuffer,
+    size_t                      parameterLength)
+{
+    if (id >= CONFIG_PARAM_COUNT)
+    {
+        Debug_LOG_ERROR("invalid parameter id %u", id);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    const param_info_t* info = &paramInfos[id];
+    param_slot_t* slot = &paramSlots[id];
+
+    configStats.lookups++;
+
+    if (!slot->isBound)
+    {
+        // the snapshot holds the parameters in the order of the configuration
+        // usually, so the position in the domain is a good first guess
+        slot->snapshotIndex = info->index;
+        slot->isBound       = true;
+    }
+
+    OS_Error_t ret = read_snapshot(info->domain, info->name, parameterBuffer,
+                                   parameterLength, &slot->snapshotIndex,
+                                   &slot->version);
+    if ((OS_ERROR_NOT_FOUND != ret) && (OS_ERROR_TRY_AGAIN != ret))
+    {
+        return ret;
+    }
+
+    if (NULL != slot->entry)
+    {
+        configStats.hits++;
+        return copy_cached(slot->entry, parameterBuffer, parameterLength);
+    }
+
+    return get_parameter_cached(*handle, info->domain, info->name,
+                                parameterBuffer, parameterLength, &slot->entry);
+}
+
+//------------------------------------------------------------------------------
+// Check if the snapshot answers the lookups of all given parameters, parameters
+// that don't exist included.
+static
+bool
+is_in_snapshot(
+    const char* DomainName,
+    const char* const ParameterNames[],
+    size_t numParameters)
+{
+    if (!isSnapshotAttached)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < numParameters; i++)
+    {
+        uint32_t version;
+        OS_Error_t ret = config_snapshot_read(OS_Dataport_getBuf(snapshotPort),
+                                              OS_Dataport_getSize(snapshotPort),
+                                              DomainName,
+                                              ParameterNames[i],
+                                              NULL,
+                                              0,
+                                              NULL,
+                                              &version);
+        if ((OS_SUCCESS != ret)
+            && (OS_ERROR_CONFIG_PARAMETER_NOT_FOUND != ret))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Add a parameter fetched by the batched RPC. It has no parameter element, so
+// it is cached only if its value is.
+static
+void
+cache_addFetched(
+    const cache_domain_t* domain,
+    const char* ParameterName,
+    bool isFound,
+    const void* value,
+    size_t valueLen)
+{
+    OS_ConfigServiceLibTypes_ParameterName_t name;
+    initializeParameterName(&name, ParameterName);
+
+    uint32_t hash = hash_name(&domain->name, &name);
+    if (NULL != cache_find(domain, &name, hash))
+    {
+        return;
+    }
+
+    cache_entry_t* entry = cache_insert(hash);
+    if (NULL == entry)
+    {
+        Debug_LOG_WARNING("config cache full, parameter %s is not cached",
+                          ParameterName);
+        return;
+    }
+    entry->domain   = domain;
+    entry->name     = name;
+    entry->isFound  = isFound;
+    entry->value    = value;
+    entry->valueLen = valueLen;
+    memset(&entry->parameter, 0, sizeof(entry->parameter));
+}
+
+//------------------------------------------------------------------------------
+// Fetch up to CONFIG_BATCH_MAX_REQUESTS parameters. Values that don't fit into
+// the dataport come in chunks, so it may take several calls.
+static
+OS_Error_t
+prefetch_batch(
+    const if_ConfigBatch_t* batch,
+    const cache_domain_t* domain,
+    const char* const ParameterNames[],
+    size_t numParameters)
+{
+    uint8_t* port = OS_Dataport_getBuf(batch->dataport);
+    const size_t portSize = OS_Dataport_getSize(batch->dataport);
+
+    uint8_t* values[CONFIG_BATCH_MAX_REQUESTS] = {0};
+    uint32_t sizes[CONFIG_BATCH_MAX_REQUESTS] = {0};
+    uint32_t received[CONFIG_BATCH_MAX_REQUESTS] = {0};
+    bool isDone[CONFIG_BATCH_MAX_REQUESTS] = {0};
+    size_t item[CONFIG_BATCH_MAX_REQUESTS];
+
+    for (;;)
+    {
+        config_batch_request_t* requests = (config_batch_request_t*)port;
+        uint32_t numRequests = 0;
+        for (size_t i = 0; i < numParameters; i++)
+        {
+            if (isDone[i])
+            {
+                continue;
+            }
+            config_batch_request_t* request = &requests[numRequests];
+            initializeName(request->domain, sizeof(request->domain),
+                           domain->name.name);
+            initializeName(request->parameter, sizeof(request->parameter),
+                           ParameterNames[i]);
+            request->offset   = received[i];
+            request->reserved = 0;
+            item[numRequests++] = i;
+        }
+        if (0 == numRequests)
+        {
+            return OS_SUCCESS;
+        }
+
+        configStats.rpcs++;
+        OS_Error_t ret = batch->getParameters(numRequests);
+        if (OS_SUCCESS != ret)
+        {
+            Debug_LOG_ERROR("getParameters() failed, ret %d", ret);
+            return ret;
+        }
+
+        bool isProgress = false;
+        const config_batch_reply_t* replies =
+            (const config_batch_reply_t*)port;
+        for (uint32_t r = 0; r < numRequests; r++)
+        {
+            const config_batch_reply_t* reply = &replies[r];
+            const size_t i = item[r];
+
+            if (OS_ERROR_CONFIG_PARAMETER_NOT_FOUND == reply->err)
+            {
+                cache_addFetched(domain, ParameterNames[i], false, NULL, 0);
+                isDone[i]  = true;
+                isProgress = true;
+                continue;
+            }
+            if ((OS_SUCCESS != reply->err)
+                || ((NULL != values[i]) && (reply->size != sizes[i]))
+                || (reply->offset != received[i])
+                || (reply->len > reply->size - received[i])
+                || (reply->dataOffset < numRequests * sizeof(*reply))
+                || (reply->dataOffset > portSize)
+                || (reply->len > portSize - reply->dataOffset))
+            {
+                Debug_LOG_WARNING("parameter %s not prefetched, err %d",
+                                  ParameterNames[i], reply->err);
+                isDone[i]  = true;
+                isProgress = true;
+                continue;
+            }
+
+            if (NULL == values[i])
+            {
+                // the space for the whole value is taken with the first chunk
+                const size_t size = (reply->size + 7) & ~(size_t)7;
+                if (size > sizeof(cache.arena) - cache.arenaUsed)
+                {
+                    // it is looked up one by one later
+                    isDone[i]  = true;
+                    isProgress = true;
+                    continue;
+                }
+                values[i] = &cache.arena[cache.arenaUsed];
+                sizes[i]  = reply->size;
+                cache.arenaUsed += size;
+            }
+
+            memcpy(&values[i][received[i]], &port[reply->dataOffset],
+                   reply->len);
+            received[i] += reply->len;
+            isProgress = isProgress || (reply->len > 0);
+
+            if (received[i] == reply->size)
+            {
+                cache_addFetched(domain, ParameterNames[i], true, values[i],
+                                 reply->size);
+                isDone[i]  = true;
+                isProgress = true;
+            }
+        }
+
+        if (!isProgress)
+        {
+            Debug_LOG_ERROR("batched parameter get makes no progress");
+            return OS_ERROR_GENERIC;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+helper_func_prefetchConfigParameters(
+    const if_ConfigBatch_t* batch,
+    const char*             DomainName,
+    const char* const       ParameterNames[],
+    size_t                  numParameters)
+{
+    Debug_ASSERT(NULL != batch);
+    Debug_ASSERT((NULL != ParameterNames) || (0 == numParameters));
+
+    if (is_in_snapshot(DomainName, ParameterNames, numParameters))
+    {
+        // the lookups need no RPC at all
+        return OS_SUCCESS;
+    }
+
+    OS_ConfigServiceLibTypes_DomainName_t domainName;
+    initializeDomainName(&domainName, DomainName);
+
+    if (NULL != cache_getDomain(&domainName))
+    {
+        // the domain has been loaded already
+        return OS_SUCCESS;
+    }
+    if (cache.numDomains >= HELPER_FUNC_CACHE_DOMAINS)
+    {
+        return OS_ERROR_INSUFFICIENT_SPACE;
+    }
+
+    // other parameters of the domain are not known
+    cache_domain_t* d = &cache.domains[cache.numDomains++];
+    d->name       = domainName;
+    d->isComplete = false;
+
+    for (size_t i = 0; i < numParameters; i += CONFIG_BATCH_MAX_REQUESTS)
+    {
+        size_t num = numParameters - i;
+        if (num > CONFIG_BATCH_MAX_REQUESTS)
+        {
+            num = CONFIG_BATCH_MAX_REQUESTS;
+        }
+
+        OS_Error_t ret = prefetch_batch(batch, d, &ParameterNames[i], num);
+        if (OS_SUCCESS != ret)
+        {
+            return ret;
+        }
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+void
+helper_func_attachConfigSnapshot(
+    OS_Dataport_t dataport)
+{
+    snapshotPort       = dataport;
+    isSnapshotAttached = true;
+}
+
+//------------------------------------------------------------------------------
+bool
+helper_func_isConfigParameterChanged(
+    uint32_t id)
+{
+    if ((id >= CONFIG_PARAM_COUNT) || !isSnapshotAttached
+        || !paramSlots[id].isBound)
+    {
+        return false;
+    }
+
+    const param_info_t* info = &paramInfos[id];
+    param_slot_t* slot = &paramSlots[id];
+
+    // only the version is read, the value stays in the snapshot
+    uint32_t version = 0;
+    OS_Error_t ret = config_snapshot_read(OS_Dataport_getBuf(snapshotPort),
+                                          OS_Dataport_getSize(snapshotPort),
+                                          info->domain,
+                                          info->name,
+                                          NULL,
+                                          0,
+                                          &slot->snapshotIndex,
+                                          &version);
+    if (OS_SUCCESS != ret)
+    {
+        return false;
+    }
+
+    return (version != slot->version);
+}
+
+//------------------------------------------------------------------------------
+void
+helper_func_getConfigStats(
+    helper_func_configStats_t* stats)
+{
+    Debug_ASSERT(NULL != stats);
+
+    *stats = configStats;
+}
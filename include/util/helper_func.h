@@ -12,6 +12,34 @@
 
 #include "OS_ConfigService.h"
 
+#include "config_batch.h"
+#include "config_snapshot.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The parameters of a domain are fetched from the ConfigServer in one pass
+// with the first lookup in the domain. Later lookups are served from the cache
+// without any RPC. Values that don't fit into the arena are fetched when they
+// are looked up. The cache is per component, all lookups must go to the same
+// ConfigServer.
+#if !defined(HELPER_FUNC_CACHE_DOMAINS)
+#define HELPER_FUNC_CACHE_DOMAINS       2
+#endif
+#if !defined(HELPER_FUNC_CACHE_PARAMETERS)
+#define HELPER_FUNC_CACHE_PARAMETERS    32  // power of 2
+#endif
+#if !defined(HELPER_FUNC_CACHE_ARENA_SIZE)
+#define HELPER_FUNC_CACHE_ARENA_SIZE    (8 * 1024)
+#endif
+
+typedef struct
+{
+    uint32_t    lookups;
+    uint32_t    hits;  // lookups that needed no RPC
+    uint32_t    rpcs;  // calls to the ConfigServer
+} helper_func_configStats_t;
+
 
 //------------------------------------------------------------------------------
 OS_Error_t
@@ -21,3 +49,43 @@ helper_func_getConfigParameter(
     const char* ParameterName,
     void*       parameterBuffer,
     size_t      parameterLength);
+
+// Same as helper_func_getConfigParameter() with the id of the parameter from
+// the generated "config_params.h". After the first lookup, the parameter is
+// found in the snapshot or the cache without searching for its name.
+OS_Error_t
+helper_func_getConfigParameterById(
+    OS_ConfigServiceHandle_t*   handle,
+    uint32_t                    id,
+    void*                       parameterBuffer,
+    size_t                      parameterLength);
+
+// Read parameters from the snapshot the ConfigServer publishes in the given
+// dataport first. Parameters that are not in it, or all of them as long as
+// there is no snapshot, are fetched with RPCs as before.
+void
+helper_func_attachConfigSnapshot(
+    OS_Dataport_t dataport);
+
+// Fetch the given parameters of a domain with the batched RPC of the
+// ConfigServer and put them into the cache, so later lookups need no RPC. Other
+// parameters of the domain are looked up one by one then. Parameters that don't
+// exist are cached as well, lookups return OS_ERROR_CONFIG_PARAMETER_NOT_FOUND.
+// Nothing is fetched if the snapshot holds all of them already.
+OS_Error_t
+helper_func_prefetchConfigParameters(
+    const if_ConfigBatch_t* batch,
+    const char*             DomainName,
+    const char* const       ParameterNames[],
+    size_t                  numParameters);
+
+// Check if the ConfigServer has published a new value of a parameter since it
+// was read last with helper_func_getConfigParameterById(). Without a snapshot,
+// parameters never change.
+bool
+helper_func_isConfigParameterChanged(
+    uint32_t id);
+
+void
+helper_func_getConfigStats(
+    helper_func_configStats_t* stats);
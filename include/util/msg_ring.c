@@ -0,0 +1,316 @@
+/*
+ * Single producer/single consumer ring of length-prefixed frames in a dataport
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "msg_ring.h"
+
+#include "lib_debug/Debug.h"
+
+#include <string.h>
+
+// length of the frame header that marks the rest of the buffer as skipped
+#define MSG_RING_LEN_WRAP   UINT32_MAX
+
+//------------------------------------------------------------------------------
+static uint32_t
+getFrameSize(
+    size_t len)
+{
+    size_t size = sizeof(msg_ring_frameHeader_t) + len;
+    return (uint32_t)((size + MSG_RING_ALIGNMENT - 1)
+                      & ~((size_t)MSG_RING_ALIGNMENT - 1));
+}
+
+//------------------------------------------------------------------------------
+static msg_ring_frameHeader_t*
+getFrameHeader(
+    msg_ring_t* self,
+    uint32_t    offset)
+{
+    return (msg_ring_frameHeader_t*)&self->ctrl->data[offset];
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+msg_ring_init(
+    msg_ring_t* self,
+    void*       mem,
+    size_t      size)
+{
+    Debug_ASSERT_SELF(self);
+
+    if ((NULL == mem) || (size <= sizeof(msg_ring_ctrl_t)))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    // nothing is written to the shared memory here, so both sides can attach
+    // in any order
+    self->ctrl     = (msg_ring_ctrl_t*)mem;
+    self->nextTail = 0;
+    self->nextSeq  = 0;
+    self->numReleased  = 0;
+    self->rateStart_ms = 0;
+    self->capacity = (uint32_t)((size - sizeof(msg_ring_ctrl_t))
+                                & ~((size_t)MSG_RING_ALIGNMENT - 1));
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+size_t
+msg_ring_getMaxFrameSize(
+    const msg_ring_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    // a frame of less than half the capacity fits either at the end or at the
+    // beginning of an empty ring
+    return ((self->capacity / 2) & ~((size_t)MSG_RING_ALIGNMENT - 1))
+           - sizeof(msg_ring_frameHeader_t) - MSG_RING_ALIGNMENT;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+msg_ring_enqueue(
+    msg_ring_t* self,
+    const void* buf,
+    size_t      len,
+    uint32_t*   seq)
+{
+    Debug_ASSERT_SELF(self);
+
+    if ((NULL == buf) || (len > msg_ring_getMaxFrameSize(self)))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    const uint32_t head = self->ctrl->producer.head;
+    const uint32_t tail = __atomic_load_n(&self->ctrl->consumer.tail,
+                                          __ATOMIC_ACQUIRE);
+    const uint32_t frameSize = getFrameSize(len);
+
+    // the head never catches up with the tail, head == tail means empty
+    uint32_t offset = head;
+    if (head >= tail)
+    {
+        if (self->capacity - head < frameSize + ((tail == 0) ? 1 : 0))
+        {
+            // does not fit at the end, try the beginning
+            if (frameSize >= tail)
+            {
+                return OS_ERROR_INSUFFICIENT_SPACE;
+            }
+            offset = 0;
+        }
+    }
+    else if (tail - head <= frameSize)
+    {
+        return OS_ERROR_INSUFFICIENT_SPACE;
+    }
+
+    const uint32_t frameSeq = self->ctrl->producer.seq;
+
+    msg_ring_frameHeader_t* hdr = getFrameHeader(self, offset);
+    hdr->len = (uint32_t)len;
+    hdr->seq = frameSeq;
+    memcpy(&hdr[1], buf, len);
+
+    if (offset != head)
+    {
+        getFrameHeader(self, head)->len = MSG_RING_LEN_WRAP;
+    }
+
+    uint32_t newHead = offset + frameSize;
+    if (newHead == self->capacity)
+    {
+        newHead = 0;
+    }
+
+    self->ctrl->producer.seq = frameSeq + 1;
+
+    // publish the frame, the consumer must see its content before the head
+    __atomic_store_n(&self->ctrl->producer.head, newHead, __ATOMIC_RELEASE);
+
+    if (NULL != seq)
+    {
+        *seq = frameSeq;
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+msg_ring_peek(
+    msg_ring_t*     self,
+    const void**    buf,
+    size_t*         len,
+    uint32_t*       seq)
+{
+    Debug_ASSERT_SELF(self);
+
+    const uint32_t head = __atomic_load_n(&self->ctrl->producer.head,
+                                          __ATOMIC_ACQUIRE);
+    uint32_t tail = self->ctrl->consumer.tail;
+
+    if (head == tail)
+    {
+        return OS_ERROR_NO_DATA;
+    }
+
+    if ((head >= self->capacity) || ((head % MSG_RING_ALIGNMENT) != 0)
+        || (tail >= self->capacity))
+    {
+        Debug_LOG_ERROR("ring offsets out of bounds, head %u, tail %u",
+                        head, tail);
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    msg_ring_frameHeader_t* hdr = getFrameHeader(self, tail);
+    if (MSG_RING_LEN_WRAP == hdr->len)
+    {
+        // the producer has written the next frame at the beginning
+        tail = 0;
+        __atomic_store_n(&self->ctrl->consumer.tail, tail, __ATOMIC_RELEASE);
+        hdr = getFrameHeader(self, tail);
+    }
+
+    // the producer is not trusted, the frame must be within the filled part.
+    // The length is read once, the producer could change it meanwhile.
+    const uint32_t frameLen = hdr->len;
+    const uint32_t end = (head > tail) ? head : self->capacity;
+    if (frameLen > end - tail - sizeof(*hdr))
+    {
+        Debug_LOG_ERROR("invalid frame length %u at offset %u", frameLen, tail);
+        return OS_ERROR_INVALID_STATE;
+    }
+
+    self->nextTail = tail + getFrameSize(frameLen);
+    if (self->nextTail == self->capacity)
+    {
+        self->nextTail = 0;
+    }
+
+    const uint32_t frameSeq = hdr->seq;
+    self->nextSeq = frameSeq + 1;
+
+    *buf = &hdr[1];
+    *len = frameLen;
+    if (NULL != seq)
+    {
+        *seq = frameSeq;
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+void
+msg_ring_release(
+    msg_ring_t* self)
+{
+    Debug_ASSERT_SELF(self);
+
+    // msg_ring_peek() has validated the frame, its length in the dataport is
+    // not read again as the producer could have changed it meanwhile
+    const uint32_t newTail = self->nextTail;
+
+    __atomic_store_n(&self->ctrl->consumer.seq, self->nextSeq,
+                     __ATOMIC_RELAXED);
+
+    // the frame must have been read completely before the producer reuses it
+    __atomic_store_n(&self->ctrl->consumer.tail, newTail, __ATOMIC_RELEASE);
+
+    self->numReleased++;
+}
+
+//------------------------------------------------------------------------------
+void
+msg_ring_updateDrainRate(
+    msg_ring_t* self,
+    uint64_t    now_ms)
+{
+    Debug_ASSERT_SELF(self);
+
+    const uint64_t elapsed_ms = now_ms - self->rateStart_ms;
+    if (elapsed_ms < MSG_RING_RATE_PERIOD_MS)
+    {
+        return;
+    }
+
+    // the first period starts with the first update
+    if (self->rateStart_ms > 0)
+    {
+        const uint32_t rate_mHz =
+            (uint32_t)(self->numReleased * 1000000ULL / elapsed_ms);
+        __atomic_store_n(&self->ctrl->consumer.drainRate_mHz, rate_mHz,
+                         __ATOMIC_RELAXED);
+    }
+
+    self->numReleased  = 0;
+    self->rateStart_ms = now_ms;
+}
+
+//------------------------------------------------------------------------------
+void
+msg_ring_resetDrainRate(
+    msg_ring_t* self,
+    uint64_t    now_ms)
+{
+    Debug_ASSERT_SELF(self);
+
+    __atomic_store_n(&self->ctrl->consumer.drainRate_mHz, 0, __ATOMIC_RELAXED);
+
+    self->numReleased  = 0;
+    self->rateStart_ms = now_ms;
+}
+
+//------------------------------------------------------------------------------
+void
+msg_ring_getStatus(
+    const msg_ring_t*   self,
+    msg_ring_status_t*  status)
+{
+    Debug_ASSERT_SELF(self);
+    Debug_ASSERT(NULL != status);
+
+    const uint32_t head = self->ctrl->producer.head;
+    const uint32_t tail = __atomic_load_n(&self->ctrl->consumer.tail,
+                                          __ATOMIC_ACQUIRE);
+    const uint32_t released = __atomic_load_n(&self->ctrl->consumer.seq,
+                                              __ATOMIC_ACQUIRE);
+
+    // the consumer is not trusted, so the values are only clamped
+    status->capacity = self->capacity;
+    status->depth    = self->ctrl->producer.seq - released;
+    status->fill     = (head >= tail) ? (head - tail)
+                       : (self->capacity - tail + head);
+    if (status->fill > self->capacity)
+    {
+        status->fill = self->capacity;
+    }
+    status->drainRate_mHz =
+        __atomic_load_n(&self->ctrl->consumer.drainRate_mHz, __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+bool
+msg_ring_isReleased(
+    const msg_ring_t*   self,
+    uint32_t            seq)
+{
+    Debug_ASSERT_SELF(self);
+
+    const uint32_t released = __atomic_load_n(&self->ctrl->consumer.seq,
+                                              __ATOMIC_ACQUIRE);
+
+    // sequence numbers wrap around, so compare the distance
+    return ((int32_t)(released - seq) > 0);
+}
@@ -0,0 +1,144 @@
+/*
+ * Single producer/single consumer ring of length-prefixed frames in a dataport
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Frames are stored contiguously and aligned to this value. A frame that does
+// not fit at the end of the buffer starts at the beginning, the remainder is
+// marked as skipped.
+#define MSG_RING_ALIGNMENT      8
+#define MSG_RING_CACHE_LINE     64
+
+// period over which the consumer measures its drain rate
+#define MSG_RING_RATE_PERIOD_MS 1000
+
+// The head is written by the producer only, the tail by the consumer only.
+// Both are offsets into the data area and are kept in separate cache lines.
+// An empty dataport (all zero) is a valid empty ring.
+typedef struct
+{
+    struct
+    {
+        uint32_t    head;
+        uint32_t    seq;
+    } __attribute__((aligned(MSG_RING_CACHE_LINE))) producer;
+
+    struct
+    {
+        uint32_t    tail;
+        uint32_t    seq;  // all frames before this one have been released
+        uint32_t    drainRate_mHz; // frames released per 1000 s
+    } __attribute__((aligned(MSG_RING_CACHE_LINE))) consumer;
+
+    uint8_t data[] __attribute__((aligned(MSG_RING_CACHE_LINE)));
+} msg_ring_ctrl_t;
+
+typedef struct
+{
+    uint32_t    len;
+    uint32_t    seq;
+} msg_ring_frameHeader_t;
+
+// local view of a ring, each side maps the dataport at a different address
+typedef struct
+{
+    msg_ring_ctrl_t*    ctrl;
+    uint32_t            capacity;
+    uint32_t            nextTail; // consumer only, set by msg_ring_peek()
+    uint32_t            nextSeq;  // consumer only, set by msg_ring_peek()
+
+    // consumer only, frames released since the drain rate was published
+    uint32_t            numReleased;
+    uint64_t            rateStart_ms;
+} msg_ring_t;
+
+// backpressure as seen by the producer
+typedef struct
+{
+    uint32_t    depth;      // frames that have not been released yet
+    uint32_t    fill;       // bytes in use
+    uint32_t    capacity;   // bytes
+    uint32_t    drainRate_mHz;  // frames released per 1000 s by the consumer
+} msg_ring_status_t;
+
+
+//------------------------------------------------------------------------------
+OS_Error_t
+msg_ring_init(
+    msg_ring_t* self,
+    void*       mem,
+    size_t      size);
+
+// Largest frame that can be enqueued into an empty ring, wherever its offsets
+// are.
+size_t
+msg_ring_getMaxFrameSize(
+    const msg_ring_t* self);
+
+// Producer: copy a frame into the ring. Returns OS_ERROR_INSUFFICIENT_SPACE if
+// the ring is full, the frame is dropped then. The sequence number of the
+// frame is returned in seq, if given. It serves as ticket for
+// msg_ring_isReleased().
+OS_Error_t
+msg_ring_enqueue(
+    msg_ring_t* self,
+    const void* buf,
+    size_t      len,
+    uint32_t*   seq);
+
+// Consumer: get the oldest frame without removing it. The frame stays valid
+// until msg_ring_release() is called. Returns OS_ERROR_NO_DATA if the ring is
+// empty.
+OS_Error_t
+msg_ring_peek(
+    msg_ring_t*     self,
+    const void**    buf,
+    size_t*         len,
+    uint32_t*       seq);
+
+// Consumer: remove the oldest frame, the producer can reuse its space.
+void
+msg_ring_release(
+    msg_ring_t* self);
+
+// Consumer: publish the rate at which frames are released, if the last update
+// is at least MSG_RING_RATE_PERIOD_MS ago. It is given in mHz, so that slow
+// producers don't see a rate of 0.
+void
+msg_ring_updateDrainRate(
+    msg_ring_t* self,
+    uint64_t    now_ms);
+
+// Consumer: publish a drain rate of 0 at once, eg if the consumer can't
+// forward any frames for a while.
+void
+msg_ring_resetDrainRate(
+    msg_ring_t* self,
+    uint64_t    now_ms);
+
+// Producer: get the queue depth, the fill level and the drain rate published
+// by the consumer.
+void
+msg_ring_getStatus(
+    const msg_ring_t*   self,
+    msg_ring_status_t*  status);
+
+// Producer: check if the consumer has released the frame with the given
+// sequence number, ie it is done with it.
+bool
+msg_ring_isReleased(
+    const msg_ring_t*   self,
+    uint32_t            seq);
@@ -0,0 +1,161 @@
+/*
+ * Binary records sent from a Sensor to the CloudConnector
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#include "sensor_record.h"
+
+#include "lib_debug/Debug.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+static bool
+hasData(
+    uint8_t type)
+{
+    return (SENSOR_RECORD_TYPE_TOPIC == type)
+           || (SENSOR_RECORD_TYPE_TEXT == type)
+           || (SENSOR_RECORD_TYPE_BATCH == type);
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+sensor_record_write(
+    void*                   buf,
+    size_t                  bufSize,
+    const sensor_record_t*  record,
+    const void*             data,
+    size_t*                 len)
+{
+    Debug_ASSERT(NULL != record);
+
+    if ((NULL == buf) || (NULL == len)
+        || (record->topicId >= SENSOR_RECORD_MAX_TOPICS))
+    {
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    size_t dataLen = 0;
+    if (hasData(record->type))
+    {
+        dataLen = record->value.dataLen;
+        if ((NULL == data) && (dataLen > 0))
+        {
+            return OS_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    if ((bufSize < sizeof(*record)) || (bufSize - sizeof(*record) < dataLen))
+    {
+        return OS_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    memcpy(buf, record, sizeof(*record));
+    if (dataLen > 0)
+    {
+        memcpy((uint8_t*)buf + sizeof(*record), data, dataLen);
+    }
+    *len = sizeof(*record) + dataLen;
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+OS_Error_t
+sensor_record_read(
+    const void*         frame,
+    size_t              frameLen,
+    sensor_record_t*    record,
+    const void**        data)
+{
+    Debug_ASSERT(NULL != record);
+    Debug_ASSERT(NULL != data);
+
+    if (frameLen < sizeof(*record))
+    {
+        Debug_LOG_ERROR("frame of %zu bytes too short for a record", frameLen);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    memcpy(record, frame, sizeof(*record));
+
+    if (record->topicId >= SENSOR_RECORD_MAX_TOPICS)
+    {
+        Debug_LOG_ERROR("invalid topic id %u", record->topicId);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    if ((record->flags & ~SENSOR_RECORD_FLAG_INSTANCE) != 0)
+    {
+        Debug_LOG_ERROR("invalid record flags 0x%x", record->flags);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    size_t dataLen = frameLen - sizeof(*record);
+    switch (record->type)
+    {
+    case SENSOR_RECORD_TYPE_TOPIC:
+    case SENSOR_RECORD_TYPE_TEXT:
+        if (record->value.dataLen != dataLen)
+        {
+            Debug_LOG_ERROR("data length %u does not match frame of %zu bytes",
+                            record->value.dataLen, frameLen);
+            return OS_ERROR_INVALID_PARAMETER;
+        }
+        *data = (const uint8_t*)frame + sizeof(*record);
+        break;
+
+    case SENSOR_RECORD_TYPE_BATCH:
+        if ((record->value.dataLen != dataLen) || (0 == dataLen)
+            || ((dataLen % sizeof(sensor_record_sample_t)) != 0))
+        {
+            Debug_LOG_ERROR("invalid batch of %u bytes in frame of %zu bytes",
+                            record->value.dataLen, frameLen);
+            return OS_ERROR_INVALID_PARAMETER;
+        }
+        *data = (const uint8_t*)frame + sizeof(*record);
+        break;
+
+    case SENSOR_RECORD_TYPE_F64:
+    case SENSOR_RECORD_TYPE_I64:
+        if (dataLen != 0)
+        {
+            Debug_LOG_ERROR("record of type %u has trailing data",
+                            record->type);
+            return OS_ERROR_INVALID_PARAMETER;
+        }
+        *data = NULL;
+        break;
+
+    default:
+        Debug_LOG_ERROR("invalid record type %u", record->type);
+        return OS_ERROR_INVALID_PARAMETER;
+    }
+
+    return OS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+size_t
+sensor_record_getNumSamples(
+    const sensor_record_t* record)
+{
+    Debug_ASSERT(NULL != record);
+
+    switch (record->type)
+    {
+    case SENSOR_RECORD_TYPE_TOPIC:
+        return 0;
+    case SENSOR_RECORD_TYPE_BATCH:
+        return record->value.dataLen / sizeof(sensor_record_sample_t);
+    default:
+        return 1;
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Binary records sent from a Sensor to the CloudConnector
+ *
+ * Copyright (C) 2024, HENSOLDT Cyber GmbH
+ * 
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * For commercial licensing, contact: info.cyber@hensoldt.net
+ */
+
+#pragma once
+
+#include "OS_Error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Topic ids are chosen by the Sensor and are valid per Sensor only
+#define SENSOR_RECORD_MAX_TOPICS    8
+
+typedef enum
+{
+    // announce the topic name for a topic id, the name follows the record
+    SENSOR_RECORD_TYPE_TOPIC = 1,
+    // reading with the value in the record
+    SENSOR_RECORD_TYPE_F64,
+    SENSOR_RECORD_TYPE_I64,
+    // reading with a text value that follows the record
+    SENSOR_RECORD_TYPE_TEXT,
+    // readings of one topic, an array of sensor_record_sample_t follows the
+    // record. The sequence number and the timestamp are the ones of the first
+    // sample.
+    SENSOR_RECORD_TYPE_BATCH,
+} sensor_record_type_t;
+
+typedef struct
+{
+    uint64_t    timestamp_ms;
+    double      value;
+} sensor_record_sample_t;
+
+// The reading is from one of several sources that share a topic, the topic is
+// extended by the instance number then.
+#define SENSOR_RECORD_FLAG_INSTANCE     (1u << 0)
+
+// Fixed layout of every record, it is the first part of a message ring frame.
+// Records of type TOPIC, TEXT and BATCH are followed by dataLen bytes.
+typedef struct
+{
+    uint8_t     type;
+    uint8_t     flags;
+    uint16_t    topicId;
+    uint32_t    seq;           // per topic and sample, gaps show drops
+    uint64_t    timestamp_ms;
+    union
+    {
+        double      f64;
+        int64_t     i64;
+        uint32_t    dataLen;
+    } value;
+    uint32_t    instance;
+    uint32_t    reserved;
+} sensor_record_t;
+
+
+//------------------------------------------------------------------------------
+// Producer: write a record and its data into buf. The data is given only for
+// records of type TOPIC, TEXT and BATCH, its length is taken from value.dataLen
+// then.
+OS_Error_t
+sensor_record_write(
+    void*                   buf,
+    size_t                  bufSize,
+    const sensor_record_t*  record,
+    const void*             data,
+    size_t*                 len);
+
+// Consumer: copy the record out of a frame and check it. The frame is in
+// shared memory, so the record is read only once. For records of type TOPIC,
+// TEXT and BATCH, data is set to the data in the frame.
+OS_Error_t
+sensor_record_read(
+    const void*         frame,
+    size_t              frameLen,
+    sensor_record_t*    record,
+    const void**        data);
+
+// Number of samples in a record, which is 0 for TOPIC and 1 for other readings.
+size_t
+sensor_record_getNumSamples(
+    const sensor_record_t* record);
@@ -46,6 +46,18 @@ echo "Creating configuration provisioned partition"
 # which maps to the channel number six of the App -> nvm_06.
 # Since the demo is using a FAT filesystem, the option is set accordingly.
 ${DIR_BIN_SDK}/cpt -i ${CURRENT_SCRIPT_DIR}/configuration/config.xml -o nvm_06 -t FAT
+
+# The ConfigServer also reads the configuration as a single image with an
+# index, which is placed at CONFIGSERVER_IMAGE_STORAGE_OFFSET (2 MiB) of the
+# same NVM. Without the image, it falls back to the files.
+if command -v python3 >/dev/null; then
+    echo "Creating configuration image"
+    python3 ${CURRENT_SCRIPT_DIR}/tools/config_image.py \
+        -i ${CURRENT_SCRIPT_DIR}/configuration/config.xml \
+        -o config_image.bin
+    dd if=config_image.bin of=nvm_06 bs=1024 seek=2048 conv=notrunc \
+        status=none
+fi
 sleep 1
 
 QEMU_PARAMS=(
@@ -28,6 +28,23 @@
 #define Debug_Config_LOG_WITH_FILE_LINE
 
 
+//-----------------------------------------------------------------------------
+// Benchmarks
+//-----------------------------------------------------------------------------
+// Uncomment to let the components run their built-in benchmarks at startup,
+// the results are written to the log.
+// #define DEMO_IOT_BENCHMARK
+
+
+//-----------------------------------------------------------------------------
+// Load generator
+//-----------------------------------------------------------------------------
+// Uncomment to replace the SensorTemp by the LoadGen component, which sends
+// synthetic readings as configured in the domain "Domain-LoadGen" of the
+// configuration and logs the throughput and the latency.
+// #define DEMO_IOT_LOADGEN
+
+
 //-----------------------------------------------------------------------------
 // Memory
 //-----------------------------------------------------------------------------
@@ -42,6 +59,35 @@
 #endif
 
 
+//-----------------------------------------------------------------------------
+// ConfigServer
+//-----------------------------------------------------------------------------
+// The configuration files are loaded into RAM at boot, lookups don't read the
+// storage then. If the records don't fit into this size (bytes), the files are
+// used directly.
+#define CONFIGSERVER_BACKEND_RAM_SIZE   (64 * 1024)
+
+// The storage is checked for a new config image with this period (ms). It
+// replaces the configuration at runtime, clients that have subscribed are
+// notified of changed parameters. 0 disables the reload.
+#define CONFIGSERVER_RELOAD_PERIOD_MS   5000
+
+
+//-----------------------------------------------------------------------------
+// CloudConnector
+//-----------------------------------------------------------------------------
+// Number of Sensor clients (max. 4), each has a message ring of its own. The
+// weights are the number of messages taken from each client per round, so a
+// client that sends a lot can't starve the others.
+#define CLOUDCONNECTOR_NUM_CLIENTS      2
+#define CLOUDCONNECTOR_CLIENT_WEIGHTS   { 1, 1 }
+
+// Messages that arrive before the first session with the broker is up are
+// buffered in an early queue of this size (bytes) and forwarded first, so no
+// readings are lost while booting.
+#define CLOUDCONNECTOR_EARLY_QUEUE_SIZE (32 * 1024)
+
+
 //-----------------------------------------------------------------------------
 // StorageServer
 //-----------------------------------------------------------------------------
@@ -51,6 +97,10 @@
 #define LOGSERVER_STORAGE_OFFSET    (1024*1024)
 #define LOGSERVER_STORAGE_SIZE      (1024*1024)
 
+// read-only config image, see tools/config_image.py
+#define CONFIGSERVER_IMAGE_STORAGE_OFFSET   (2*1024*1024)
+#define CONFIGSERVER_IMAGE_STORAGE_SIZE     (64*1024)
+
 
 //-----------------------------------------------------------------------------
 // ChanMUX
@@ -96,6 +146,7 @@
 #define SENSOR_LOGGER_ID            30
 #define NWDRIVER_LOGGER_ID          40
 #define NWSTACK_LOGGER_ID           50
+#define SENSORHUB_LOGGER_ID         60
 
 #define NIC_DRIVER_RINGBUFFER_NUMBER_ELEMENTS 16
 #define NIC_DRIVER_RINGBUFFER_SIZE                                             \
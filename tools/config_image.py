@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+
+#-------------------------------------------------------------------------------
+#
+# Create the read-only configuration image of the ConfigServer from the XML
+# configuration file, the layout is described in
+# components/ConfigServer/src/config_image.h
+#
+# Copyright (C) 2024, HENSOLDT Cyber GmbH
+# 
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# For commercial licensing, contact: info.cyber@hensoldt.net
+#
+#-------------------------------------------------------------------------------
+
+import argparse
+import os
+import struct
+import sys
+import xml.etree.ElementTree as ET
+
+MAGIC       = 0x49474643  # "CFGI"
+VERSION     = 1
+ALIGNMENT   = 8
+NAME_SIZE   = 32
+
+TYPES = {'int32': 0, 'int64': 1, 'string': 2, 'blob': 3}
+
+HEADER_FORMAT = '<IHHIIIIIIII'
+ENTRY_FORMAT  = '<%ds%dsIIII' % (NAME_SIZE, NAME_SIZE)
+
+HASH_OFFSET_BASIS = 2166136261
+HASH_PRIME        = 16777619
+MAX_DISPLACEMENT  = 1 << 20
+
+
+#-------------------------------------------------------------------------------
+def fnv1a(hash, data):
+    for b in data:
+        hash = ((hash ^ b) * HASH_PRIME) & 0xFFFFFFFF
+    return hash
+
+
+#-------------------------------------------------------------------------------
+# must match hashKey() of config_image.c
+def hash_key(seed, domain, parameter):
+    hash = ((HASH_OFFSET_BASIS ^ seed) * HASH_PRIME) & 0xFFFFFFFF
+    return fnv1a(hash, domain + b'/' + parameter)
+
+
+#-------------------------------------------------------------------------------
+def align(n):
+    return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1)
+
+
+#-------------------------------------------------------------------------------
+def encode_value(param_type, text, base_dir):
+    text = (text or '').strip()
+    if param_type == 'int32':
+        return struct.pack('<i', int(text, 0))
+    if param_type == 'int64':
+        return struct.pack('<q', int(text, 0))
+    if param_type == 'string':
+        return text.encode() + b'\0'
+    # blobs are given as path relative to the XML file
+    with open(os.path.join(base_dir, text.lstrip('/')), 'rb') as f:
+        return f.read()
+
+
+#-------------------------------------------------------------------------------
+# The parameters of a domain are given as a flat sequence of param_name, type,
+# access_policy and value elements.
+def read_parameters(xml_file):
+    base_dir = os.path.dirname(os.path.abspath(xml_file))
+    params = []
+    for domain in ET.parse(xml_file).getroot().iter('domain'):
+        domain_name = domain.get('name').strip()
+        current = None
+        for element in domain:
+            if element.tag == 'param_name':
+                current = {'domain': domain_name, 'name': element.text.strip()}
+                params.append(current)
+            elif element.tag == 'type':
+                current['type'] = element.text.strip()
+            elif element.tag == 'value':
+                current['value'] = encode_value(current['type'], element.text,
+                                                base_dir)
+
+    for p in params:
+        for name in (p['domain'], p['name']):
+            if len(name.encode()) > NAME_SIZE:
+                sys.exit('ERROR: name %s longer than %d bytes'
+                         % (name, NAME_SIZE))
+        if p['type'] not in TYPES:
+            sys.exit('ERROR: unknown type %s of %s' % (p['type'], p['name']))
+        p['key'] = (p['domain'].encode(), p['name'].encode())
+
+    if len(set(p['key'] for p in params)) != len(params):
+        sys.exit('ERROR: duplicate parameter names')
+
+    return params
+
+
+#-------------------------------------------------------------------------------
+# Hash and displace: the buckets with the most keys are placed first, each one
+# gets the smallest seed that maps all of its keys to free slots. Buckets with
+# a single key take any free slot, which is stored as -slot - 1.
+def build_index(keys):
+    n = len(keys)
+    num_buckets = max(1, n // 2)
+    buckets = [[] for _ in range(num_buckets)]
+    for i, k in enumerate(keys):
+        buckets[hash_key(0, *k) % num_buckets].append(i)
+
+    displacement = [0] * num_buckets
+    slots = [None] * n
+    order = sorted(range(num_buckets), key=lambda b: -len(buckets[b]))
+
+    for b in order:
+        if len(buckets[b]) <= 1:
+            break
+        for d in range(1, MAX_DISPLACEMENT):
+            placed = [hash_key(d, *keys[i]) % n for i in buckets[b]]
+            if (len(set(placed)) == len(placed)
+                    and all(slots[s] is None for s in placed)):
+                for i, s in zip(buckets[b], placed):
+                    slots[s] = i
+                displacement[b] = d
+                break
+        else:
+            sys.exit('ERROR: no perfect hash found')
+
+    free = [s for s in range(n) if slots[s] is None]
+    for b in order:
+        if len(buckets[b]) == 1:
+            s = free.pop()
+            slots[s] = buckets[b][0]
+            displacement[b] = -s - 1
+
+    return displacement, slots
+
+
+#-------------------------------------------------------------------------------
+def create_image(params):
+    displacement, slots = build_index([p['key'] for p in params])
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    buckets_offset = header_size
+    entries_offset = align(buckets_offset + 4 * len(displacement))
+    values_offset = align(entries_offset
+                          + struct.calcsize(ENTRY_FORMAT) * len(params))
+
+    entries = b''
+    values = b''
+    for i in slots:
+        p = params[i]
+        entries += struct.pack(ENTRY_FORMAT, p['key'][0], p['key'][1],
+                               TYPES[p['type']], len(p['value']),
+                               values_offset + len(values), 0)
+        values += p['value'].ljust(align(len(p['value'])), b'\0')
+
+    body = struct.pack('<%di' % len(displacement), *displacement)
+    body = body.ljust(entries_offset - buckets_offset, b'\0')
+    body += entries.ljust(values_offset - entries_offset, b'\0')
+    body += values
+
+    header = struct.pack(HEADER_FORMAT, MAGIC, VERSION, header_size,
+                         header_size + len(body), fnv1a(HASH_OFFSET_BASIS, body),
+                         len(params), len(displacement), buckets_offset,
+                         entries_offset, values_offset, 0)
+    return header + body
+
+
+#-------------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(
+        description='Create the configuration image of the ConfigServer')
+    parser.add_argument('-i', '--input', required=True,
+                        help='XML configuration file')
+    parser.add_argument('-o', '--output', required=True,
+                        help='image file')
+    args = parser.parse_args()
+
+    params = read_parameters(args.input)
+    image = create_image(params)
+    with open(args.output, 'wb') as f:
+        f.write(image)
+
+    print('%d parameters, %d bytes' % (len(params), len(image)))
+
+
+if __name__ == '__main__':
+    main()
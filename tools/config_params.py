@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+
+#-------------------------------------------------------------------------------
+#
+# Create the header with the ids, types and sizes of the configuration
+# parameters from the XML configuration file, so the components look them up
+# by id and can check their buffers at compile time
+#
+# Copyright (C) 2024, HENSOLDT Cyber GmbH
+# 
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# For commercial licensing, contact: info.cyber@hensoldt.net
+#
+#-------------------------------------------------------------------------------
+
+import argparse
+import os
+import re
+
+from config_image import TYPES, read_parameters
+
+DOMAIN_PREFIX = 'Domain-'
+
+
+#-------------------------------------------------------------------------------
+def identifier(name):
+    return re.sub('[^A-Z0-9]', '_', name.upper())
+
+
+#-------------------------------------------------------------------------------
+def domain_identifier(name):
+    if name.startswith(DOMAIN_PREFIX):
+        name = name[len(DOMAIN_PREFIX):]
+    return 'CONFIG_DOMAIN_' + identifier(name)
+
+
+#-------------------------------------------------------------------------------
+def define(name, value):
+    return '#define %-56s %s\n' % (name, value)
+
+
+#-------------------------------------------------------------------------------
+# The ids are numbered in the order of the XML file, so the parameters of a
+# domain have consecutive ids and their index is the position in the domain.
+def create_header(params, xml_name):
+    domains = []
+    for p in params:
+        if p['domain'] not in domains:
+            domains.append(p['domain'])
+
+    out = ('/*\n'
+           ' * Configuration parameters, generated from %s by\n'
+           ' * tools/config_params.py. Do not edit.\n'
+           ' */\n'
+           '\n'
+           '#pragma once\n'
+           '\n' % xml_name)
+
+    for t, value in sorted(TYPES.items(), key=lambda item: item[1]):
+        out += define('CONFIG_PARAM_TYPE_' + t.upper(), value)
+    out += '\n'
+
+    ids = set()
+    table = []
+    param_id = 0
+    for d in domains:
+        domain_params = [p for p in params if p['domain'] == d]
+        dom = domain_identifier(d)
+        out += define(dom, '"%s"' % d)
+        out += define(dom + '_FIRST', param_id)
+        out += define(dom + '_COUNT', len(domain_params))
+        out += '\n'
+
+        for index, p in enumerate(domain_params):
+            name = 'CONFIG_PARAM_%s_%s' % (dom[len('CONFIG_DOMAIN_'):],
+                                           identifier(p['name']))
+            if name in ids:
+                raise SystemExit('ERROR: parameter %s of %s has no unique id'
+                                 % (p['name'], d))
+            ids.add(name)
+
+            out += define(name, param_id)
+            out += define(name + '_NAME', '"%s"' % p['name'])
+            out += define(name + '_TYPE',
+                          'CONFIG_PARAM_TYPE_' + p['type'].upper())
+            out += define(name + '_MAX_SIZE', len(p['value']))
+            out += define(name + '_INDEX', index)
+            out += '\n'
+
+            table.append('    PARAM(%s, %s, "%s", %d)'
+                         % (name, dom, p['name'], index))
+            param_id += 1
+
+    out += define('CONFIG_PARAM_COUNT', param_id)
+    out += '\n'
+    out += ('// PARAM(id, domain, name, index) for all parameters\n'
+            '#define CONFIG_PARAMS(PARAM) \\\n')
+    out += ' \\\n'.join(table) + '\n'
+
+    return out
+
+
+#-------------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(
+        description='Create the header with the configuration parameter ids')
+    parser.add_argument('-i', '--input', required=True,
+                        help='XML configuration file')
+    parser.add_argument('-o', '--output', required=True,
+                        help='header file')
+    args = parser.parse_args()
+
+    header = create_header(read_parameters(args.input),
+                           os.path.basename(args.input))
+
+    with open(args.output, 'w') as f:
+        f.write(header)
+
+
+if __name__ == '__main__':
+    main()